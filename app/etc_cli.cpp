@@ -9,7 +9,7 @@
 
 void ParseOptions(CompilationDriver& driver, int argc, char** argv) {
   auto opt = '\0';
-  while ((opt = getopt(argc, argv, "tm:")) != -1) {
+  while ((opt = getopt(argc, argv, "tm:rsa")) != -1) {
     switch (opt) {
       case 't':
         driver.SetTestBuild();
@@ -17,8 +17,18 @@ void ParseOptions(CompilationDriver& driver, int argc, char** argv) {
       case 'm':
         driver.SetMainModule(optarg);
         break;
+      case 'r':
+        driver.SetReport();
+        break;
+      case 's':
+        driver.SetShareLayouts();
+        break;
+      case 'a':
+        driver.SetPoolAllocator();
+        break;
       default: /* '?' */
-        fprintf(stderr, "Usage: %s [-m] module [-t] \n", argv[0]);
+        fprintf(stderr, "Usage: %s [-m] module [-t] [-r] [-s] [-a] \n",
+                argv[0]);
         exit(EXIT_FAILURE);
     }
   }
@@ -9,12 +9,16 @@ enum class Intrinsic : uint8_t {
   PRINT,
   ASSERT,
   IS_NULL,
+  DELETE,
+  SIZE_OF,
 };
 
 static std::unordered_map<std::string_view, Intrinsic> intrinsics_table{
     {"print", Intrinsic::PRINT},
     {"assert", Intrinsic::ASSERT},
     {"isNull", Intrinsic::IS_NULL},
+    {"delete", Intrinsic::DELETE},
+    {"sizeOf", Intrinsic::SIZE_OF},
 };
 
 }  // namespace ast::elaboration
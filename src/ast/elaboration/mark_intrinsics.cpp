@@ -70,6 +70,10 @@ void MarkIntrinsics::VisitReturn(ReturnStatement* node) {
   return_value = node;
 }
 
+void MarkIntrinsics::VisitLoopControl(LoopControlStatement* node) {
+  return_value = node;
+}
+
 void MarkIntrinsics::VisitAssignment(AssignmentStatement* node) {
   node->target_ = Eval(node->target_)->as<LvalueExpression>();
   node->value_ = Eval(node->value_)->as<Expression>();
@@ -124,6 +128,17 @@ void MarkIntrinsics::VisitIf(IfExpression* node) {
   return_value = node;
 }
 
+void MarkIntrinsics::VisitWhile(WhileExpression* node) {
+  node->condition_ = Eval(node->condition_)->as<Expression>();
+  node->body_ = Eval(node->body_)->as<Expression>();
+
+  if (node->step_) {
+    node->step_ = Eval(node->step_)->as<Statement>();
+  }
+
+  return_value = node;
+}
+
 void MarkIntrinsics::VisitMatch(MatchExpression* node) {
   node->against_ = Eval(node->against_)->as<Expression>();
 
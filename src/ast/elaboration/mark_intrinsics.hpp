@@ -11,6 +11,7 @@ class MarkIntrinsics : public ReturnVisitor<TreeNode*> {
  public:
   void VisitYield(YieldStatement* node) override;
   void VisitReturn(ReturnStatement* node) override;
+  void VisitLoopControl(LoopControlStatement* node) override;
   void VisitAssignment(AssignmentStatement* node) override;
   void VisitExprStatement(ExprStatement* node) override;
 
@@ -31,6 +32,7 @@ class MarkIntrinsics : public ReturnVisitor<TreeNode*> {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitWhile(WhileExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
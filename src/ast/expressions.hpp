@@ -244,6 +244,12 @@ class IntrinsicCall : public FnCallExpression {
       case ast::elaboration::Intrinsic::IS_NULL:
         return &types::builtin_bool;
 
+      case ast::elaboration::Intrinsic::DELETE:
+        return &types::builtin_unit;
+
+      case ast::elaboration::Intrinsic::SIZE_OF:
+        return &types::builtin_int;
+
       default:
         std::abort();
     }
@@ -594,3 +600,63 @@ class YieldStatement : public Expression {
 };
 
 //////////////////////////////////////////////////////////////////////
+
+class WhileExpression : public Expression {
+ public:
+  WhileExpression(lex::Token while_token, Expression* condition,
+                  Expression* body, Statement* step = nullptr)
+      : while_token_{while_token},
+        condition_{condition},
+        body_{body},
+        step_{step} {
+  }
+
+  virtual void Accept(Visitor* visitor) override {
+    visitor->VisitWhile(this);
+  }
+
+  virtual types::Type* GetType() override {
+    return &types::builtin_unit;
+  }
+
+  virtual lex::Location GetLocation() override {
+    return while_token_.location;
+  }
+
+  lex::Token while_token_;
+
+  Expression* condition_;
+  Expression* body_;
+
+  // Runs after the body and on `continue`, e.g. `i = i + 1` of a range loop
+  Statement* step_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// break or continue
+class LoopControlStatement : public Expression {
+ public:
+  LoopControlStatement(lex::Token keyword) : keyword_{keyword} {
+  }
+
+  virtual void Accept(Visitor* visitor) override {
+    visitor->VisitLoopControl(this);
+  }
+
+  virtual types::Type* GetType() override {
+    return &types::builtin_never;
+  }
+
+  virtual lex::Location GetLocation() override {
+    return keyword_.location;
+  }
+
+  bool IsBreak() const {
+    return keyword_.type == lex::TokenType::BREAK;
+  }
+
+  lex::Token keyword_;
+};
+
+//////////////////////////////////////////////////////////////////////
@@ -131,8 +131,12 @@ void ContextBuilder::VisitFunDecl(FunDeclStatement* node) {
       auto fn = current_fn_;  // For return
       current_fn_ = node->GetName();
 
+      auto depth = loop_depth_;
+      loop_depth_ = 0;
+
       node->body_->Accept(this);
       current_fn_ = fn;
+      loop_depth_ = depth;
     }
 
     PopScopeLayer();
@@ -218,6 +222,15 @@ void ContextBuilder::VisitReturn(ReturnStatement* node) {
   node->return_value_->Accept(this);
 }
 
+void ContextBuilder::VisitLoopControl(LoopControlStatement* node) {
+  if (loop_depth_ == 0) {
+    throw std::runtime_error{
+        fmt::format("{} outside of a loop at {}",
+                    node->IsBreak() ? "break" : "continue",
+                    node->GetLocation().Format())};
+  }
+}
+
 void ContextBuilder::VisitAssignment(AssignmentStatement* node) {
   node->value_->Accept(this);
   node->target_->Accept(this);
@@ -287,6 +300,18 @@ void ContextBuilder::VisitIf(IfExpression* node) {
   node->false_branch_->Accept(this);
 }
 
+void ContextBuilder::VisitWhile(WhileExpression* node) {
+  node->condition_->Accept(this);
+
+  loop_depth_ += 1;
+  node->body_->Accept(this);
+  loop_depth_ -= 1;
+
+  if (node->step_) {
+    node->step_->Accept(this);
+  }
+}
+
 void ContextBuilder::VisitMatch(MatchExpression* node) {
   node->against_->Accept(this);
 
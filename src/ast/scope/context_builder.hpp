@@ -12,6 +12,7 @@ class ContextBuilder : public AbortVisitor {
 
   virtual void VisitYield(YieldStatement* node) override;
   virtual void VisitReturn(ReturnStatement* node) override;
+  virtual void VisitLoopControl(LoopControlStatement* node) override;
   virtual void VisitAssignment(AssignmentStatement* node) override;
   virtual void VisitExprStatement(ExprStatement* node) override;
 
@@ -32,6 +33,7 @@ class ContextBuilder : public AbortVisitor {
   virtual void VisitDeref(DereferenceExpression* node) override;
   virtual void VisitAddressof(AddressofExpression* node) override;
   virtual void VisitIf(IfExpression* node) override;
+  virtual void VisitWhile(WhileExpression* node) override;
   virtual void VisitMatch(MatchExpression* node) override;
   virtual void VisitNew(NewExpression* node) override;
   virtual void VisitBlock(BlockExpression* node) override;
@@ -53,6 +55,9 @@ class ContextBuilder : public AbortVisitor {
 
   std::string_view current_fn_;
 
+  // For break and continue
+  size_t loop_depth_ = 0;
+
  public:
   // For dumping all symbols in the program
   std::vector<Context*> debug_context_leafs_{current_context_};
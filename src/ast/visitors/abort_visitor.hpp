@@ -13,6 +13,10 @@ class AbortVisitor : public Visitor {
     std::abort();
   }
 
+  virtual void VisitLoopControl(LoopControlStatement*) override {
+    std::abort();
+  }
+
   virtual void VisitTypeDecl(TypeDeclStatement*) override {
     std::abort();
   }
@@ -89,6 +93,10 @@ class AbortVisitor : public Visitor {
     std::abort();
   }
 
+  virtual void VisitWhile(WhileExpression*) override {
+    std::abort();
+  }
+
   virtual void VisitMatch(MatchExpression*) override {
     std::abort();
   }
@@ -1,98 +1,190 @@
 #pragma once
 
 #include <ast/visitors/visitor.hpp>
-#include <cstdlib>
+
+#include <ast/declarations.hpp>
+#include <ast/patterns.hpp>
+
+//////////////////////////////////////////////////////////////////////
+
+// Visits every node of the tree and does nothing else. Analyses derive
+// from it and override the nodes they are interested in.
 
 class JustWalk : public Visitor {
  public:
-  virtual void VisitYield(YieldStatement*) {
-    std::abort();
+  // Statements
+
+  void VisitYield(YieldStatement* node) override {
+    node->yield_value_->Accept(this);
+  }
+
+  void VisitReturn(ReturnStatement* node) override {
+    node->return_value_->Accept(this);
+  }
+
+  void VisitLoopControl(LoopControlStatement*) override {
+  }
+
+  void VisitAssignment(AssignmentStatement* node) override {
+    node->target_->Accept(this);
+    node->value_->Accept(this);
+  }
+
+  void VisitExprStatement(ExprStatement* node) override {
+    node->expr_->Accept(this);
+  }
+
+  // Declarations
+
+  void VisitTypeDecl(TypeDeclStatement*) override {
   }
 
-  virtual void VisitReturn(ReturnStatement*) {
-    std::abort();
+  void VisitVarDecl(VarDeclStatement* node) override {
+    if (node->value_) {
+      node->value_->Accept(this);
+    }
   }
 
-  virtual void VisitTypeDecl(TypeDeclStatement*) {
-    std::abort();
+  void VisitFunDecl(FunDeclStatement* node) override {
+    if (node->body_) {
+      node->body_->Accept(this);
+    }
   }
 
-  virtual void VisitVarDecl(VarDeclStatement*) {
-    std::abort();
+  void VisitTraitDecl(TraitDeclaration* node) override {
+    for (auto method : node->methods_) {
+      method->Accept(this);
+    }
   }
 
-  virtual void VisitFunDecl(FunDeclStatement*) {
-    std::abort();
+  void VisitImplDecl(ImplDeclaration* node) override {
+    for (auto method : node->trait_methods_) {
+      method->Accept(this);
+    }
   }
 
-  virtual void VisitAssignment(AssignmentStatement*) {
-    std::abort();
+  // Patterns
+
+  void VisitBindingPat(BindingPattern*) override {
+  }
+
+  void VisitDiscardingPat(DiscardingPattern*) override {
+  }
+
+  void VisitLiteralPat(LiteralPattern*) override {
+  }
+
+  void VisitStructPat(StructPattern*) override {
   }
 
-  virtual void VisitExprStatement(ExprStatement*) {
-    std::abort();
+  void VisitVariantPat(VariantPattern* node) override {
+    if (node->inner_pat_) {
+      node->inner_pat_->Accept(this);
+    }
   }
 
   // Expressions
 
-  virtual void VisitComparison(ComparisonExpression*) {
-    std::abort();
+  void VisitComparison(ComparisonExpression* node) override {
+    node->left_->Accept(this);
+    node->right_->Accept(this);
+  }
+
+  void VisitBinary(BinaryExpression* node) override {
+    node->left_->Accept(this);
+    node->right_->Accept(this);
+  }
+
+  void VisitUnary(UnaryExpression* node) override {
+    node->operand_->Accept(this);
   }
 
-  virtual void VisitBinary(BinaryExpression*) {
-    std::abort();
+  void VisitDeref(DereferenceExpression* node) override {
+    node->operand_->Accept(this);
   }
 
-  virtual void VisitUnary(UnaryExpression*) {
-    std::abort();
+  void VisitAddressof(AddressofExpression* node) override {
+    node->operand_->Accept(this);
   }
 
-  virtual void VisitDeref(DereferenceExpression*) {
-    std::abort();
+  void VisitIf(IfExpression* node) override {
+    node->condition_->Accept(this);
+    node->true_branch_->Accept(this);
+    node->false_branch_->Accept(this);
   }
 
-  virtual void VisitAddressof(AddressofExpression*) {
-    std::abort();
+  void VisitWhile(WhileExpression* node) override {
+    node->condition_->Accept(this);
+    node->body_->Accept(this);
+
+    if (node->step_) {
+      node->step_->Accept(this);
+    }
   }
 
-  virtual void VisitIf(IfExpression*) {
-    std::abort();
+  void VisitMatch(MatchExpression* node) override {
+    node->against_->Accept(this);
+
+    for (auto& [pat, expr] : node->patterns_) {
+      pat->Accept(this);
+      expr->Accept(this);
+    }
   }
 
-  virtual void VisitNew(NewExpression*) {
-    std::abort();
+  void VisitNew(NewExpression* node) override {
+    if (node->allocation_size_) {
+      node->allocation_size_->Accept(this);
+    }
+
+    if (node->initial_value_) {
+      node->initial_value_->Accept(this);
+    }
   }
 
-  virtual void VisitBlock(BlockExpression*) {
-    std::abort();
+  void VisitBlock(BlockExpression* node) override {
+    for (auto stmt : node->stmts_) {
+      stmt->Accept(this);
+    }
+
+    if (node->final_) {
+      node->final_->Accept(this);
+    }
   }
 
-  virtual void VisitFnCall(FnCallExpression*) {
-    std::abort();
+  void VisitFnCall(FnCallExpression* node) override {
+    node->callable_->Accept(this);
+
+    for (auto a : node->arguments_) {
+      a->Accept(this);
+    }
   }
 
-  virtual void VisitInstrinsic(IntrinsicCall*) {
-    std::abort();
+  void VisitIntrinsic(IntrinsicCall* node) override {
+    for (auto a : node->arguments_) {
+      a->Accept(this);
+    }
   }
 
-  virtual void VisitCompoundInitalizer(CompoundInitializerExpr*) {
-    std::abort();
+  void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
+    for (auto& mem : node->initializers_) {
+      if (mem.init) {
+        mem.init->Accept(this);
+      }
+    }
   }
 
-  virtual void VisitFieldAccess(FieldAccessExpression*) {
-    std::abort();
+  void VisitFieldAccess(FieldAccessExpression* node) override {
+    node->struct_expression_->Accept(this);
   }
 
-  virtual void VisitVarAccess(VarAccessExpression*) {
-    std::abort();
+  void VisitVarAccess(VarAccessExpression*) override {
   }
 
-  virtual void VisitLiteral(LiteralExpression*) {
-    std::abort();
+  void VisitLiteral(LiteralExpression*) override {
   }
 
-  virtual void VisitTypecast(TypecastExpression*) {
-    std::abort();
+  void VisitTypecast(TypecastExpression* node) override {
+    node->expr_->Accept(this);
   }
 };
 
@@ -9,6 +9,7 @@ class UnaryExpression;
 class DereferenceExpression;
 class AddressofExpression;
 class IfExpression;
+class WhileExpression;
 class MatchExpression;
 class NewExpression;
 class BlockExpression;
@@ -26,6 +27,7 @@ class Statement;
 class ExprStatement;
 class YieldStatement;
 class ReturnStatement;
+class LoopControlStatement;
 class AssignmentStatement;
 
 //////////////////////////////////////////////////////////////////////
@@ -56,6 +58,8 @@ class Visitor {
 
   virtual void VisitReturn(ReturnStatement* node) = 0;
 
+  virtual void VisitLoopControl(LoopControlStatement* node) = 0;
+
   virtual void VisitAssignment(AssignmentStatement* node) = 0;
 
   virtual void VisitExprStatement(ExprStatement* node) = 0;
@@ -98,6 +102,8 @@ class Visitor {
 
   virtual void VisitIf(IfExpression* node) = 0;
 
+  virtual void VisitWhile(WhileExpression* node) = 0;
+
   virtual void VisitMatch(MatchExpression* node) = 0;
 
   virtual void VisitNew(NewExpression* node) = 0;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <driver/driver_errors.hpp>
+#include <driver/report.hpp>
 
 #include <types/constraints/generate/algorithm_w.hpp>
 #include <types/instantiate/instantiator.hpp>
@@ -128,30 +129,53 @@ class CompilationDriver {
     main_module_ = mod;
   }
 
+  void SetShareLayouts() {
+    options_.share_layouts = true;
+  }
+
+  void SetPoolAllocator() {
+    options_.pool_allocator = true;
+  }
+
+  void SetReport() {
+    report_.Enable();
+  }
+
   void Compile() {
-    ParseAllModules();
-    RegisterSymbols();
+    CompileModules();
+    report_.Print();
+  }
+
+  void CompileModules() {
+    report_.Time("parse", [&]() {
+      ParseAllModules();
+      RegisterSymbols();
+    });
 
     // Those in the beginning have the least dependencies (see TopSort(...))
-    for (size_t i = 0; i < modules_.size(); i += 1) {
-      ProcessModule(&modules_[i]);
-    }
+    report_.Time("context", [&]() {
+      for (size_t i = 0; i < modules_.size(); i += 1) {
+        ProcessModule(&modules_[i]);
+      }
+    });
 
-    for (auto& m : modules_) {
-      m.InferTypes(solver_);
-    }
+    report_.Time("inference", [&]() {
+      for (auto& m : modules_) {
+        m.InferTypes(solver_);
+      }
+    });
 
     if (test_build) {
       FMT_ASSERT(modules_.back().GetName() == main_module_,
                  "Last module should be the main one");
-      modules_.back().Compile(nullptr);  // CompileTests
+      modules_.back().Compile(nullptr, options_, report_);  // CompileTests
       return;
     }
 
     auto inst_root = module_of_.at("main");
     auto main_sym = inst_root->GetExportedSymbol("main");
 
-    inst_root->Compile(main_sym->GetFunctionDefinition());
+    inst_root->Compile(main_sym->GetFunctionDefinition(), options_, report_);
   }
 
   Module* GetModuleOf(std::string_view symbol) {
@@ -169,5 +193,8 @@ class CompilationDriver {
 
   bool test_build = false;
 
+  CompileOptions options_;
+  CompilationReport report_;
+
   types::constraints::ConstraintSolver solver_;
 };
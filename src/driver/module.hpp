@@ -1,5 +1,8 @@
 #pragma once
 
+#include <driver/options.hpp>
+#include <driver/report.hpp>
+
 #include <types/constraints/generate/algorithm_w.hpp>
 #include <types/constraints/expand/expand.hpp>
 #include <types/instantiate/instantiator.hpp>
@@ -60,15 +63,50 @@ class Module {
     return inst.Flush();
   }
 
-  void Compile(Declaration* main) {
-    auto [funs, gen_ty_list] = [&]() {
+  void Compile(Declaration* main, const CompileOptions& options,
+               CompilationReport& report) {
+    auto [funs, gen_ty_list] = report.Time("instantiation", [&]() {
       return main ? CompileMain(main) : CompileTests();
-    }();
+    });
+
+    for (auto f : funs) {
+      report.Count(fmt::format("instances of {}", f->GetName()));
+    }
+
+    report.Time("codegen", [&]() {
+      qbe::IrEmitter ir;
+
+      if (options.pool_allocator) {
+        ir.SetPoolAllocator();
+      }
+
+      ir.EmitTypes(std::move(gen_ty_list));
+
+      ir.EmitFunctions(funs);
+
+      for (auto& group : ir.TailGroups()) {
+        report.Count(
+            fmt::format("tail-call group {}", fmt::join(group, ", ")),
+            group.size());
+      }
+
+      report.Count("locals in temporaries", ir.LocalsInTemporaries());
+      report.Count("allocations on the stack", ir.AllocationsOnStack());
+
+      auto& match = ir.GetMatchStats();
+      report.Count("match: lookup tables", match.lookup_tables);
+      report.Count("match: binary searches", match.binary_searches);
+      report.Count("match: dense switches", match.dense_switches);
+      report.Count("match: compare chains", match.compare_chains);
 
-    qbe::IrEmitter ir;
-    ir.EmitTypes(std::move(gen_ty_list));
+      for (auto& [pass, n] : ir.PassStats()) {
+        report.Count(fmt::format("pass: {}", pass), n);
+      }
 
-    for (auto f : funs) f->Accept(&ir);
+      if (options.share_layouts) {
+        report.Count("functions shared by layout", ir.ShareByLayout());
+      }
+    });
   }
 
   std::string_view GetName() const {
@@ -0,0 +1,15 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////
+
+// Switches set from the command line
+
+struct CompileOptions {
+  // Fold instances that only differ in types of the same layout (-s)
+  bool share_layouts = false;
+
+  // Allocate through the size-class pools emitted into the program (-a)
+  bool pool_allocator = false;
+};
+
+//////////////////////////////////////////////////////////////////////
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <map>
+
+//////////////////////////////////////////////////////////////////////
+
+// Phase timings and counters, printed to stderr after compilation (-r)
+
+class CompilationReport {
+ public:
+  void Enable() {
+    enabled_ = true;
+  }
+
+  template <typename F>
+  auto Time(std::string_view phase, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+
+    struct Stop {
+      ~Stop() {
+        auto end = std::chrono::steady_clock::now();
+        report->timings_.emplace_back(phase, end - start);
+      }
+
+      CompilationReport* report;
+      std::string_view phase;
+      std::chrono::steady_clock::time_point start;
+    } stop{this, phase, start};
+
+    return f();
+  }
+
+  void Count(std::string_view what, size_t n = 1) {
+    counters_[std::string{what}] += n;
+  }
+
+  void Print() const {
+    if (!enabled_) {
+      return;
+    }
+
+    using Ms = std::chrono::duration<double, std::milli>;
+
+    fmt::print(stderr, "\n===== Compilation report =====\n");
+
+    for (auto& [phase, duration] : timings_) {
+      fmt::print(stderr, "{:<40} {:>10.3f} ms\n", phase, Ms{duration}.count());
+    }
+
+    for (auto& [what, n] : counters_) {
+      fmt::print(stderr, "{:<40} {:>10}\n", what, n);
+    }
+  }
+
+ private:
+  bool enabled_ = false;
+
+  using Duration = std::chrono::steady_clock::duration;
+  std::vector<std::pair<std::string_view, Duration>> timings_;
+
+  std::map<std::string, size_t> counters_;
+};
+
+//////////////////////////////////////////////////////////////////////
@@ -32,7 +32,22 @@ class IdentTable {
     map_.insert({"Char", TokenType::TY_CHAR});
     map_.insert({"Unit", TokenType::TY_UNIT});
     map_.insert({"Int", TokenType::TY_INT});
+    map_.insert({"Int64", TokenType::TY_INT64});
+    map_.insert({"Size", TokenType::TY_INT64});
 
+    map_.insert({"I8", TokenType::TY_I8});
+    map_.insert({"I16", TokenType::TY_I16});
+    map_.insert({"I32", TokenType::TY_INT});
+    map_.insert({"I64", TokenType::TY_INT64});
+    map_.insert({"U8", TokenType::TY_U8});
+    map_.insert({"U16", TokenType::TY_U16});
+    map_.insert({"U32", TokenType::TY_U32});
+    map_.insert({"U64", TokenType::TY_U64});
+
+    map_.insert({"F32", TokenType::TY_F32});
+    map_.insert({"F64", TokenType::TY_F64});
+
+    map_.insert({"continue", TokenType::CONTINUE});
     map_.insert({"return", TokenType::RETURN});
     map_.insert({"struct", TokenType::STRUCT});
     map_.insert({"export", TokenType::EXPORT});
@@ -41,6 +56,8 @@ class IdentTable {
     map_.insert({"trait", TokenType::TRAIT});
     map_.insert({"yield", TokenType::YIELD});
     map_.insert({"false", TokenType::FALSE});
+    map_.insert({"while", TokenType::WHILE});
+    map_.insert({"break", TokenType::BREAK});
     map_.insert({"then", TokenType::THEN});
     map_.insert({"impl", TokenType::IMPL});
     map_.insert({"else", TokenType::ELSE});
@@ -53,6 +70,7 @@ class IdentTable {
     map_.insert({"sum", TokenType::SUM});
     map_.insert({"for", TokenType::FOR});
     map_.insert({"if", TokenType::IF});
+    map_.insert({"in", TokenType::IN});
     map_.insert({"of", TokenType::OF});
   }
 
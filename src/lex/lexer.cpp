@@ -1,5 +1,9 @@
 #include <lex/lexer.hpp>
 
+#include <charconv>
+#include <cstdlib>
+#include <string>
+
 namespace lex {
 
 Lexer::Lexer(std::istream& source) : scanner_{source} {
@@ -201,7 +205,12 @@ std::optional<TokenType> Lexer::MatchOperator() {
     case '@':
       return TokenType::ATTRIBUTE;
     case '.':
-      return TokenType::DOT;
+      if (scanner_.PeekNextSymbol() == '.') {
+        scanner_.MoveRight();
+        return TokenType::DOT_DOT;
+      } else {
+        return TokenType::DOT;
+      }
     case EOF:
       return TokenType::TOKEN_EOF;
     case '_':
@@ -277,20 +286,37 @@ std::optional<Token> Lexer::MatchCharLiteral() {
 ////////////////////////////////////////////////////////////////////
 
 std::optional<Token> Lexer::MatchNumericLiteral() {
-  int result = 0, match_span = 0;
+  std::string text;
 
   while (isdigit(scanner_.CurrentSymbol())) {
-    result *= 10;
-    result += scanner_.CurrentSymbol() - '0';
-
+    text += scanner_.CurrentSymbol();
     scanner_.MoveRight();
-    match_span += 1;
   }
 
-  if (match_span == 0) {
+  if (text.empty()) {
     return std::nullopt;
   }
 
+  // A fraction makes it floating-point, while `0..n` is a range
+  if (scanner_.CurrentSymbol() == '.' && isdigit(scanner_.PeekNextSymbol())) {
+    text += '.';
+    scanner_.MoveRight();
+
+    while (isdigit(scanner_.CurrentSymbol())) {
+      text += scanner_.CurrentSymbol();
+      scanner_.MoveRight();
+    }
+
+    return Token{TokenType::FLOAT, scanner_.GetLocation(),
+                 {std::strtod(text.c_str(), nullptr)}};
+  }
+
+  int64_t result = 0;
+  auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), result);
+
+  FMT_ASSERT(error == std::errc{}, "\nInteger literal out of range\n");
+
   return Token{TokenType::NUMBER, scanner_.GetLocation(), {result}};
 }
 
@@ -4,6 +4,7 @@
 
 #include <variant>
 #include <cstddef>
+#include <cstdint>
 
 namespace lex {
 
@@ -13,7 +14,8 @@ struct Token {
   using SemInfo = std::variant<  //
       std::monostate,            //
       std::string_view,          //
-      int                        //
+      int64_t,                   //
+      double                     //
       >;
 
   Token(TokenType type, Location start, SemInfo sem_info = {})
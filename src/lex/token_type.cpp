@@ -9,6 +9,7 @@ namespace lex {
 // clang-format off
 #define AST_NODE_LIST(code) \
   code(NUMBER)              \
+  code(FLOAT)               \
   code(CHAR)                \
   code(STRING)              \
   code(IDENTIFIER)          \
@@ -40,6 +41,7 @@ namespace lex {
   code(STAR)                \
   code(ARROW)               \
   code(ARROW_CAST)          \
+  code(DOT_DOT)             \
   code(NEW)                 \
   code(FUN)                 \
   code(DOT)                 \
@@ -55,6 +57,15 @@ namespace lex {
   code(IMPL)                \
   code(UNDERSCORE)          \
   code(TY_INT)              \
+  code(TY_INT64)            \
+  code(TY_I8)               \
+  code(TY_I16)              \
+  code(TY_U8)               \
+  code(TY_U16)              \
+  code(TY_U32)              \
+  code(TY_U64)              \
+  code(TY_F32)              \
+  code(TY_F64)              \
   code(TY_BOOL)             \
   code(TY_CHAR)             \
   code(TY_UNIT)             \
@@ -64,6 +75,10 @@ namespace lex {
   code(BIT_OR)              \
   code(THEN)                \
   code(ELSE)                \
+  code(WHILE)               \
+  code(IN)                  \
+  code(BREAK)               \
+  code(CONTINUE)            \
   code(COLON)               \
   code(SEMICOLON)           \
   code(RETURN)              \
@@ -8,6 +8,7 @@ namespace lex {
 
 enum class TokenType {
   NUMBER,
+  FLOAT,
   CHAR,
   STRING,
   IDENTIFIER,
@@ -55,6 +56,7 @@ enum class TokenType {
   STAR,
   ARROW,
   ARROW_CAST,
+  DOT_DOT,
 
   NEW,
 
@@ -76,6 +78,15 @@ enum class TokenType {
 
 
   TY_INT,
+  TY_INT64,
+  TY_I8,
+  TY_I16,
+  TY_U8,
+  TY_U16,
+  TY_U32,
+  TY_U64,
+  TY_F32,
+  TY_F64,
   TY_BOOL,
   TY_CHAR,
   TY_UNIT,
@@ -87,6 +98,11 @@ enum class TokenType {
   THEN,
   ELSE,
 
+  WHILE,
+  IN,
+  BREAK,
+  CONTINUE,
+
   COLON,
   SEMICOLON,
   RETURN,
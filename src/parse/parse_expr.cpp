@@ -26,10 +26,22 @@ Expression* Parser::ParseKeywordExpresssion() {
     return yield_statement;
   }
 
+  if (auto loop_control = ParseLoopControlStatement()) {
+    return loop_control;
+  }
+
   if (auto if_expr = ParseIfExpression()) {
     return if_expr;
   }
 
+  if (auto while_expr = ParseWhileExpression()) {
+    return while_expr;
+  }
+
+  if (auto for_expr = ParseForExpression()) {
+    return for_expr;
+  }
+
   if (auto match_expr = ParseMatchExpression()) {
     return match_expr;
   }
@@ -99,6 +111,81 @@ Expression* Parser::ParseIfExpression() {
 
 ////////////////////////////////////////////////////////////////////
 
+Expression* Parser::ParseWhileExpression() {
+  if (!Matches(lex::TokenType::WHILE)) {
+    return nullptr;
+  }
+
+  auto while_token = lexer_.GetPreviousToken();
+
+  auto condition = ParseExpression();
+  auto body = ParseExpression();
+
+  return new WhileExpression{while_token, condition, body};
+}
+
+////////////////////////////////////////////////////////////////////
+
+// for i in lo .. hi body
+//
+//          is lowered to
+//
+// {
+//   var i = lo;
+//   var for.end = hi;
+//   while i < for.end body   <<<--- with `i = i + 1` as the step
+// }
+
+Expression* Parser::ParseForExpression() {
+  if (!Matches(lex::TokenType::FOR)) {
+    return nullptr;
+  }
+
+  auto for_token = lexer_.GetPreviousToken();
+  auto loc = for_token.location;
+
+  Consume(lex::TokenType::IDENTIFIER);
+  auto counter = lexer_.GetPreviousToken();
+
+  Consume(lex::TokenType::IN);
+  auto from = ParseExpression();
+
+  Consume(lex::TokenType::DOT_DOT);
+  auto to = ParseExpression();
+
+  auto body = ParseExpression();
+
+  // Can't be written in the source, so it shadows nothing
+  lex::Token end{lex::TokenType::IDENTIFIER, loc, std::string_view{"for.end"}};
+
+  auto condition = new ComparisonExpression{
+      new VarAccessExpression{counter},
+      lex::Token{lex::TokenType::LT, loc},
+      new VarAccessExpression{end},
+  };
+
+  auto step = new AssignmentStatement{
+      lex::Token{lex::TokenType::ASSIGN, loc},
+      new VarAccessExpression{counter},
+      new BinaryExpression{
+          new VarAccessExpression{counter},
+          lex::Token{lex::TokenType::PLUS, loc},
+          new LiteralExpression{lex::Token{lex::TokenType::NUMBER, loc, {1}}},
+      },
+  };
+
+  std::vector<Statement*> stmts{
+      new VarDeclStatement{new VarAccessExpression{counter}, from, nullptr},
+      new VarDeclStatement{new VarAccessExpression{end}, to, nullptr},
+  };
+
+  auto loop = new WhileExpression{for_token, condition, body, step};
+
+  return new BlockExpression{for_token, std::move(stmts), loop};
+}
+
+////////////////////////////////////////////////////////////////////
+
 Expression* Parser::ParseMatchExpression() {
   if (!Matches(lex::TokenType::MATCH)) {
     return nullptr;
@@ -205,9 +292,23 @@ Expression* Parser::ParseComparison() {
 ////////////////////////////////////////////////////////////////////
 
 Expression* Parser::ParseBinary() {
-  Expression* first = ParseUnary();
+  Expression* first = ParseTerm();
 
   while (Matches(lex::TokenType::PLUS) || Matches(lex::TokenType::MINUS)) {
+    auto token = lexer_.GetPreviousToken();
+    auto second = ParseTerm();
+    first = new BinaryExpression(first, token, second);
+  }
+
+  return first;
+}
+
+////////////////////////////////////////////////////////////////////
+
+Expression* Parser::ParseTerm() {
+  Expression* first = ParseUnary();
+
+  while (Matches(lex::TokenType::STAR) || Matches(lex::TokenType::DIV)) {
     auto token = lexer_.GetPreviousToken();
     auto second = ParseUnary();
     first = new BinaryExpression(first, token, second);
@@ -439,6 +540,7 @@ Expression* Parser::ParsePrimary() {
 
   switch (token.type) {
     case lex::TokenType::NUMBER:
+    case lex::TokenType::FLOAT:
     case lex::TokenType::STRING:
     case lex::TokenType::FALSE:
     case lex::TokenType::CHAR:
@@ -525,6 +627,16 @@ Expression* Parser::ParseReturnStatement() {
 
 ///////////////////////////////////////////////////////////////////
 
+Expression* Parser::ParseLoopControlStatement() {
+  if (!Matches(lex::TokenType::BREAK) && !Matches(lex::TokenType::CONTINUE)) {
+    return nullptr;
+  }
+
+  return new LoopControlStatement{lexer_.GetPreviousToken()};
+}
+
+///////////////////////////////////////////////////////////////////
+
 Expression* Parser::ParseYieldStatement() {
   if (!Matches(lex::TokenType::YIELD)) {
     return nullptr;
@@ -144,6 +144,33 @@ types::Type* Parser::ParsePrimitiveType() {
     case lex::TokenType::TY_INT:
       return &types::builtin_int;
 
+    case lex::TokenType::TY_INT64:
+      return &types::builtin_int64;
+
+    case lex::TokenType::TY_I8:
+      return &types::builtin_i8;
+
+    case lex::TokenType::TY_I16:
+      return &types::builtin_i16;
+
+    case lex::TokenType::TY_U8:
+      return &types::builtin_u8;
+
+    case lex::TokenType::TY_U16:
+      return &types::builtin_u16;
+
+    case lex::TokenType::TY_U32:
+      return &types::builtin_u32;
+
+    case lex::TokenType::TY_U64:
+      return &types::builtin_u64;
+
+    case lex::TokenType::TY_F32:
+      return &types::builtin_f32;
+
+    case lex::TokenType::TY_F64:
+      return &types::builtin_f64;
+
     case lex::TokenType::TY_BOOL:
       return &types::builtin_bool;
 
@@ -48,7 +48,10 @@ class Parser {
 
   Expression* ParseReturnStatement();
   Expression* ParseYieldStatement();
+  Expression* ParseLoopControlStatement();
   Expression* ParseIfExpression();
+  Expression* ParseWhileExpression();
+  Expression* ParseForExpression();
   Expression* ParseMatchExpression();
   Expression* ParseNewExpression();
 
@@ -56,6 +59,7 @@ class Parser {
 
   Expression* ParseComparison();
   Expression* ParseBinary();
+  Expression* ParseTerm();
 
   Expression* ParseUnary();
   Expression* ParseDeref();
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ast/visitors/just_walk_visitor.hpp>
+
+#include <unordered_set>
+
+namespace qbe {
+
+////////////////////////////////////////////////////////////////////
+
+// Names of the variables of a function body whose address is taken.
+// The other ones need no memory, scalars among them live in temporaries.
+
+class AddressTaken : public JustWalk {
+ public:
+  explicit AddressTaken(FunDeclStatement* fun) {
+    fun->body_->Accept(this);
+  }
+
+  bool Contains(std::string_view name) const {
+    return names_.contains(name);
+  }
+
+  void VisitAddressof(AddressofExpression* node) override {
+    auto place = node->operand_;
+
+    // &s.field is inside of s
+    while (auto access = place->as<FieldAccessExpression>()) {
+      place = access->struct_expression_;
+    }
+
+    if (auto var = place->as<VarAccessExpression>()) {
+      names_.insert(var->GetName());
+    }
+
+    JustWalk::VisitAddressof(node);
+  }
+
+ private:
+  std::unordered_set<std::string_view> names_;
+};
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe
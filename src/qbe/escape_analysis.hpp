@@ -0,0 +1,259 @@
+#pragma once
+
+#include <qbe/ir_emitter.hpp>
+
+#include <ast/visitors/just_walk_visitor.hpp>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace qbe {
+
+////////////////////////////////////////////////////////////////////
+
+// Intraprocedural escape analysis over the instances. Every function is
+// summarized by which of its parameters escape; the summaries start out
+// empty and grow until they agree with the bodies, so recursion is fine.
+// A `new` bound to a variable that keeps its pointee in may then live
+// in the frame of the function.
+
+class EscapeAnalysis {
+ public:
+  // Larger objects stay on the heap, to keep the frames small
+  static constexpr size_t kMaxStackBytes = 4096;
+
+  EscapeAnalysis(IrEmitter& emitter, const std::vector<FunDeclStatement*>& funs)
+      : emitter_{emitter} {
+    for (auto fun : funs) {
+      if (fun->body_) {
+        params_.emplace(emitter_.FunctionName(fun),
+                        std::vector<bool>(fun->formals_.size()));
+      }
+    }
+
+    for (auto changed = true; changed;) {
+      changed = false;
+
+      for (auto fun : funs) {
+        if (fun->body_) {
+          changed |= Summarize(fun);
+        }
+      }
+    }
+  }
+
+  // The allocations of `fun` that don't outlive it
+  std::vector<NewExpression*> NonEscaping(FunDeclStatement* fun) {
+    StackCandidates candidates{emitter_, fun};
+    std::unordered_set<std::string_view> names;
+
+    for (auto& [name, _] : candidates.found) {
+      names.insert(name);
+    }
+
+    PointerUses uses{*this, fun, std::move(names)};
+    std::vector<NewExpression*> result;
+
+    for (auto& [name, node] : candidates.found) {
+      if (!uses.Escapes(name, 1)) {
+        result.push_back(node);
+      }
+    }
+
+    return result;
+  }
+
+ private:
+  // Finds which of the given pointer variables may hand their pointee out
+  // of the function. Loads, stores and indexing through a pointer keep it
+  // in, and so does passing it to a parameter that stays in the callee.
+  // Any other use, or a second declaration of the name, lets it out.
+
+  class PointerUses : public JustWalk {
+   public:
+    PointerUses(EscapeAnalysis& analysis, FunDeclStatement* fun,
+                std::unordered_set<std::string_view> names)
+        : analysis_{analysis}, names_{std::move(names)} {
+      fun->body_->Accept(this);
+    }
+
+    // `declarations` made in the body are expected
+    bool Escapes(std::string_view name, size_t declarations = 0) const {
+      auto it = declared_.find(name);
+      auto count = it == declared_.end() ? 0 : it->second;
+      return escaping_.contains(name) || count != declarations;
+    }
+
+    void VisitVarAccess(VarAccessExpression* node) override {
+      if (names_.contains(node->GetName())) {
+        escaping_.insert(node->GetName());
+      }
+    }
+
+    void VisitVarDecl(VarDeclStatement* node) override {
+      declared_[node->GetName()] += 1;
+      JustWalk::VisitVarDecl(node);
+    }
+
+    void VisitBindingPat(BindingPattern* node) override {
+      declared_[node->name_.GetName()] += 1;
+    }
+
+    void VisitDeref(DereferenceExpression* node) override {
+      if (!taking_address_ && Through(node->operand_)) {
+        return;
+      }
+
+      JustWalk::VisitDeref(node);
+    }
+
+    // Storing into the variable itself drops the old pointer
+    void VisitAssignment(AssignmentStatement* node) override {
+      if (!Tracked(node->target_)) {
+        node->target_->Accept(this);
+      }
+
+      node->value_->Accept(this);
+    }
+
+    void VisitAddressof(AddressofExpression* node) override {
+      TakeAddress(node->operand_);
+    }
+
+    // Reinterpreting an aggregate yields its address
+    void VisitTypecast(TypecastExpression* node) override {
+      if (analysis_.emitter_.measure_.IsCompound(node->expr_->GetType())) {
+        TakeAddress(node->expr_);
+      } else {
+        JustWalk::VisitTypecast(node);
+      }
+    }
+
+    void VisitFnCall(FnCallExpression* node) override {
+      auto escaping = analysis_.EscapingParams(node);
+
+      node->callable_->Accept(this);
+
+      for (size_t i = 0; i < node->arguments_.size(); i++) {
+        auto arg = node->arguments_[i];
+
+        if (escaping && i < escaping->size() && !(*escaping)[i] &&
+            Tracked(arg)) {
+          continue;
+        }
+
+        arg->Accept(this);
+      }
+    }
+
+   private:
+    bool Tracked(Expression* expr) const {
+      auto var = expr->as<VarAccessExpression>();
+      return var && names_.contains(var->GetName());
+    }
+
+    // Walks the rest of an address computed from a tracked pointer: `v`,
+    // or `v + i` for `v[i]`
+    bool Through(Expression* pointer) {
+      if (auto binary = pointer->as<BinaryExpression>()) {
+        if (Tracked(binary->left_)) {
+          binary->right_->Accept(this);
+          return true;
+        }
+      }
+
+      return Tracked(pointer);
+    }
+
+    void TakeAddress(Expression* place) {
+      auto saved = std::exchange(taking_address_, true);
+      place->Accept(this);
+      taking_address_ = saved;
+    }
+
+   private:
+    EscapeAnalysis& analysis_;
+    std::unordered_set<std::string_view> names_;
+
+    std::unordered_set<std::string_view> escaping_;
+    std::unordered_map<std::string_view, size_t> declared_;
+    bool taking_address_ = false;
+  };
+
+  // `var v = new T`, or `new [n] T` with a literal `n`, of bounded size
+  struct StackCandidates : JustWalk {
+    StackCandidates(IrEmitter& emitter, FunDeclStatement* fun)
+        : emitter{emitter} {
+      fun->body_->Accept(this);
+    }
+
+    void VisitVarDecl(VarDeclStatement* node) override {
+      if (auto alloc = node->value_->as<NewExpression>()) {
+        if (auto size = Size(alloc); size > 0 && size <= kMaxStackBytes) {
+          found.emplace_back(node->GetName(), alloc);
+        }
+      }
+
+      JustWalk::VisitVarDecl(node);
+    }
+
+    size_t Size(NewExpression* node) {
+      size_t count = 1;
+
+      if (auto n = node->allocation_size_) {
+        auto literal = n->as<LiteralExpression>();
+
+        if (!literal || literal->token_.type != lex::TokenType::NUMBER) {
+          return 0;
+        }
+
+        auto value = std::get<int64_t>(literal->token_.sem_info);
+        count = value > 0 ? value : 0;
+      }
+
+      return count * emitter.GetTypeSize(node->underlying_);
+    }
+
+    IrEmitter& emitter;
+    std::vector<std::pair<std::string_view, NewExpression*>> found;
+  };
+
+  // Null if the callee is not known
+  const std::vector<bool>* EscapingParams(FnCallExpression* call) {
+    auto it = params_.find(emitter_.CalleeName(call));
+    return it == params_.end() ? nullptr : &it->second;
+  }
+
+  bool Summarize(FunDeclStatement* fun) {
+    std::unordered_set<std::string_view> names;
+
+    for (auto& formal : fun->formals_) {
+      names.insert(formal.GetName());
+    }
+
+    PointerUses uses{*this, fun, std::move(names)};
+    auto& escaping = params_.at(emitter_.FunctionName(fun));
+    auto changed = false;
+
+    for (size_t i = 0; i < escaping.size(); i++) {
+      if (!escaping[i] && uses.Escapes(fun->formals_[i].GetName())) {
+        escaping[i] = true;
+        changed = true;
+      }
+    }
+
+    return changed;
+  }
+
+ private:
+  IrEmitter& emitter_;
+
+  // Keyed by the name of the instance
+  std::unordered_map<std::string, std::vector<bool>> params_;
+};
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe
@@ -27,13 +27,12 @@ class GenAddr : public AbortVisitor {
   }
 
   virtual void VisitDeref(DereferenceExpression* node) override {
-    fmt::print("  {} =l copy {}\n", target_id_.Emit(),
-               parent_.Eval(node->operand_).Emit());
+    parent_.Print("  {} =l copy {}\n", target_id_,
+                  parent_.Eval(node->operand_));
   }
 
   virtual void VisitFnCall(FnCallExpression* node) override {
-    fmt::print("  {} =l copy {}\n", target_id_.Emit(),
-               parent_.Eval(node).Emit());
+    parent_.Print("  {} =l copy {}\n", target_id_, parent_.Eval(node));
   }
 
   virtual void VisitFieldAccess(FieldAccessExpression* node) override {
@@ -42,14 +41,15 @@ class GenAddr : public AbortVisitor {
     auto offset = parent_.measure_.MeasureFieldOffset(
         node->struct_expression_->GetType(), node->field_name_);
 
-    fmt::print("  {} =l add {}, {}\n",  //
-               target_id_.Emit(), target_id_.Emit(), offset);
+    parent_.Print("  {} =l add {}, {}\n",  //
+                  target_id_, target_id_, offset);
   }
 
   virtual void VisitVarAccess(VarAccessExpression* node) override {
-    fmt::print("  {} =l copy {}\n",  //
-               target_id_.Emit(),
-               parent_.named_values_.at(node->GetName()).Emit());
+    FMT_ASSERT(parent_.named_values_.at(node->GetName()).tag != Value::LOCAL,
+               "Address of a variable kept in a temporary");
+    parent_.Print("  {} =l copy {}\n",  //
+                  target_id_, parent_.named_values_.at(node->GetName()));
   }
 
  private:
@@ -16,9 +16,9 @@ namespace qbe {
 
 class GenAt : public AbortVisitor {
  public:
-  // Target id is a pointer
-  GenAt(IrEmitter& parent, Value target_id)
-      : parent_{parent}, target_id_{target_id} {
+  // Target id is a pointer, `fresh` if the memory is unobservable yet
+  GenAt(IrEmitter& parent, Value target_id, bool fresh = false)
+      : parent_{parent}, target_id_{target_id}, fresh_{fresh} {
   }
 
   std::string Give() {
@@ -31,8 +31,8 @@ class GenAt : public AbortVisitor {
     }
 
     auto addr = parent_.Eval(node->operand_);
-    auto [s, a] = parent_.SizeAlign(node);
-    parent_.Copy(a, s, addr, target_id_);
+    auto size = parent_.GetTypeSize(node->GetType());
+    parent_.Copy(size, addr, target_id_);
   }
 
   virtual void VisitFieldAccess(FieldAccessExpression* node) override {
@@ -47,28 +47,46 @@ class GenAt : public AbortVisitor {
     auto offset = parent_.measure_.MeasureFieldOffset(
         node->struct_expression_->GetType(), node->field_name_);
 
-    fmt::print("  {} =l add {}, {}\n", addr.Emit(), addr.Emit(), offset);
+    parent_.Print("  {} =l add {}, {}\n", addr, addr, offset);
 
-    auto [s, a] = parent_.SizeAlign(node);
+    auto size = parent_.GetTypeSize(node->GetType());
 
-    parent_.Copy(a, s, addr, target_id_);
+    parent_.Copy(size, addr, target_id_);
   }
 
   virtual void VisitFnCall(FnCallExpression* node) override {
+    // The callee could see its destination through a pointer otherwise
+    if (fresh_ &&
+        parent_.ReturnsInSlot(node->GetType(), parent_.HasCName(node))) {
+      parent_.EmitCall(node, target_id_);
+      return;
+    }
+
     auto call = parent_.Eval(node);
 
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, call, target_id_);
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, call, target_id_);
+      return;
+    }
+
+    if (parent_.measure_.IsZST(node->GetType())) {
       return;
     }
 
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), call,
+                  target_id_);
+  }
+
+  virtual void VisitIntrinsic(IntrinsicCall* node) override {
+    auto id = parent_.Eval(node);
+
     if (parent_.measure_.IsZST(node->GetType())) {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), call.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitCompoundInitalizer(CompoundInitializerExpr* node) override {
@@ -80,95 +98,111 @@ class GenAt : public AbortVisitor {
 
     if (underlying->tag == types::TypeTag::TY_SUM) {
       auto discr = measure.SumDiscriminant(underlying, field);
-      fmt::print("  storew {}, {}\n", discr, target_id_.Emit());
+      parent_.Print("  storew {}, {}\n", discr, target_id_);
     }
 
     auto target = parent_.GenTemporary();
-    fmt::print("  {} = l copy {}\n", target.Emit(), target_id_.Emit());
+    parent_.Print("  {} = l copy {}\n", target, target_id_);
 
     for (auto& i : node->initializers_) {
       auto offset = measure.MeasureFieldOffset(node->GetType(), i.field);
 
       // Move the pointer
-      fmt::print("  {} =l add {}, {}\n", target.Emit(), target.Emit(),
-                 offset - previous_offset);
+      parent_.Print("  {} =l add {}, {}\n", target, target,
+                    offset - previous_offset);
 
       previous_offset = offset;
 
       if (i.init) {
-        parent_.GenAtAddress(i.init, target);
+        parent_.GenAtAddress(i.init, target, fresh_);
       }
     }
   }
 
   virtual void VisitNew(NewExpression* node) override {
     auto mem = parent_.Eval(node);
-    fmt::print("  storel {}, {}\n", mem.Emit(), target_id_.Emit());
+    parent_.Print("  storel {}, {}\n", mem, target_id_);
   }
 
   virtual void VisitAddressof(AddressofExpression* node) override {
     auto mem = parent_.Eval(node);
-    fmt::print("  storel {}, {}\n", mem.Emit(), target_id_.Emit());
+    parent_.Print("  storel {}, {}\n", mem, target_id_);
   }
 
   virtual void VisitUnary(UnaryExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitIf(IfExpression* node) override {
-    auto id = parent_.Eval(node);
-
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, id, target_id_);
+      BuildCompound(node, [&](Value dest) {
+        parent_.EmitIf(node, dest, true);
+      });
       return;
     }
 
+    auto id = parent_.Eval(node);
+
     if (parent_.measure_.IsZST(node->GetType())) {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
+  }
+
+  virtual void VisitWhile(WhileExpression* node) override {
+    parent_.Eval(node);  // Unit
   }
 
   virtual void VisitTypecast(TypecastExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitBinary(BinaryExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitComparison(ComparisonExpression* node) override {
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitBlock(BlockExpression* node) override {
+    if (parent_.measure_.IsCompound(node->GetType()) && node->final_) {
+      BuildCompound(node, [&](Value dest) {
+        for (auto stmt : node->stmts_) {
+          stmt->Accept(&parent_);
+        }
+
+        parent_.GenAtAddress(node->final_, dest, true);
+      });
+      return;
+    }
+
     auto id = parent_.Eval(node);
 
     if (parent_.measure_.IsZST(node->GetType())) {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitVarAccess(VarAccessExpression* node) override {
     auto id = parent_.Eval(node);
 
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, id, target_id_);
+      auto size = parent_.GetTypeSize(node->GetType());
+      parent_.Copy(size, id, target_id_);
       return;
     }
 
@@ -176,25 +210,26 @@ class GenAt : public AbortVisitor {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitMatch(MatchExpression* node) override {
-    auto id = parent_.Eval(node);
-
     if (parent_.measure_.IsCompound(node->GetType())) {
-      auto [s, a] = parent_.SizeAlign(node);
-      parent_.Copy(a, s, id, target_id_);
+      BuildCompound(node, [&](Value dest) {
+        parent_.EmitMatch(node, dest, true);
+      });
       return;
     }
 
+    auto id = parent_.Eval(node);
+
     if (parent_.measure_.IsZST(node->GetType())) {
       return;
     }
 
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
   }
 
   virtual void VisitLiteral(LiteralExpression* node) override {
@@ -203,13 +238,33 @@ class GenAt : public AbortVisitor {
     }
 
     auto id = parent_.Eval(node);
-    fmt::print("  store{} {}, {}\n", StoreSuf(node->GetType()), id.Emit(),
-               target_id_.Emit());
+    parent_.Print("  store{} {}, {}\n", StoreSuf(node->GetType()), id,
+                  target_id_);
+  }
+
+ private:
+  // Unless the destination is fresh, the arms may read it while they
+  // build the value, as in `p = match p { ... }`. The value is then
+  // built in a slot of its own and copied over.
+  template <typename Build>
+  void BuildCompound(Expression* node, Build build) {
+    if (fresh_) {
+      build(target_id_);
+      return;
+    }
+
+    auto slot = parent_.GenTemporary();
+    auto [size, alignment] = parent_.SizeAlign(node);
+    parent_.PrintAlloc(slot, alignment, size);
+
+    build(slot);
+    parent_.Copy(size, slot, target_id_);
   }
 
  private:
   IrEmitter& parent_;
   Value target_id_;
+  bool fresh_;
   std::string result_;
 };
 
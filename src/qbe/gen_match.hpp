@@ -10,22 +10,49 @@
 #include <fmt/format.h>
 
 #include <unordered_map>
+#include <algorithm>
 #include <utility>
+#include <string>
+#include <vector>
+#include <span>
 
 namespace qbe {
 
+//////////////////////////////////////////////////////////////////////
+
+// A value a pattern compares with a constant
+
+struct MatchTest {
+  // Identifies the value: `:v` enters the payload of variant v, `.f`
+  // the field f. Tests with equal paths look at the same value.
+  std::string path;
+  size_t offset = 0;  // From the start of the matched value
+
+  types::Type* type = nullptr;  // Null for a discriminant
+  size_t alternatives = 0;      // Values it may have, 0 if too many
+
+  Value constant;
+};
+
+struct MatchRow {
+  size_t arm = 0;
+
+  std::vector<MatchTest> tests;  // Each one is only valid after the previous
+  std::vector<std::pair<std::string_view, size_t>> bindings;  // Name, offset
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// A variant and a field pattern hold a single pattern, so every pattern
+// is a chain and flattens into the tests along it
+
 class GenMatch : public AbortVisitor {
  public:
-  GenMatch(IrEmitter& parent, Value target_id, int next_arm, bool literal)
-      : parent_{parent},
-        target_id_{target_id},
-        literal_(literal),
-        next_arm_(next_arm) {
+  GenMatch(IrEmitter& parent, MatchRow& row) : parent_{parent}, row_{row} {
   }
 
   void VisitBindingPat(BindingPattern* node) {
-    parent_.named_values_.insert_or_assign(
-        node->name_, literal_ ? target_id_.AsPattern() : target_id_);
+    row_.bindings.emplace_back(node->name_.GetName(), offset_);
   }
 
   void VisitDiscardingPat(DiscardingPattern*) {
@@ -33,97 +60,338 @@ class GenMatch : public AbortVisitor {
   }
 
   void VisitLiteralPat(LiteralPattern* node) {
-    if (node->pat_->GetType()->tag == types::TypeTag::TY_UNIT) {
+    auto ty = node->pat_->GetType();
+
+    if (ty->tag == types::TypeTag::TY_UNIT) {
       return;
     }
 
-    auto out = parent_.GenTemporary();
+    row_.tests.push_back(MatchTest{
+        .path = path_,
+        .offset = offset_,
+        .type = ty,
+        .alternatives = ty->tag == types::TypeTag::TY_BOOL ? 2u : 0u,
+        .constant = parent_.Eval(node->pat_),
+    });
+  }
 
-    auto against = parent_.Eval(node->pat_);
+  // In the form `.some.next n`  <<---  parsed as VariantPattern
+  void VisitVariantPat(VariantPattern* node) {
+    auto ty = node->GetType();
+    auto storage = types::TypeStorage(ty);
+
+    if (storage->tag == types::TypeTag::TY_SUM) {
+      row_.tests.push_back(MatchTest{
+          .path = path_,
+          .offset = offset_,
+          .alternatives = storage->as_sum.first.size(),
+          .constant = parent_.GenConstInt(
+              parent_.measure_.SumDiscriminant(ty, node->name_)),
+      });
+    }
 
-    auto ty = node->pat_->GetType();
-    auto eq_type = ToQbeType(ty);
-    auto load_suf = LoadSuf(ty);
+    auto sep = storage->tag == types::TypeTag::TY_SUM ? ':' : '.';
+    fmt::format_to(std::back_inserter(path_), "{}{}", sep,
+                   node->name_.GetName());
 
-    auto target = target_id_;
+    offset_ += parent_.measure_.MeasureFieldOffset(node->type_, node->name_);
 
-    if (!literal_) {
-      auto load = parent_.GenTemporary();
-      fmt::print("  {} = {} load{} {}  \n",  //
-                 load.Emit(), eq_type, load_suf, target_id_.Emit());
-      target = load;
+    if (auto& inner = node->inner_pat_) {
+      inner->Accept(this);
     }
+  }
 
-    auto condition = parent_.GenTemporary();
+ private:
+  IrEmitter& parent_;
+  MatchRow& row_;
 
-    fmt::print("  {} =w ceq{} {}, {}\n",  //
-               condition.Emit(), eq_type, target.Emit(), against.Emit());
-    fmt::print("  jnz {}, @match.{}.check.{}, @match.{}\n",  //
-               condition.Emit(), next_arm_ - 1, check++, next_arm_);
-    fmt::print("@match.{}.check.{}\n", next_arm_ - 1, check - 1);
+  std::string path_;
+  size_t offset_ = 0;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Compiles the arms into a decision tree, after Maranget: the first
+// undecided test of the first row that can still match picks a value,
+// which is loaded once and dispatched on by a switch or a binary search
+// over the constants the rows compare it with. Rows that don't test that value
+// follow every branch, so no value is looked at twice on a path.
+
+class DecisionTree {
+ public:
+  // `target` holds the matched value, or its address if `in_memory`
+  DecisionTree(IrEmitter& parent, Value target, bool in_memory, int match_id)
+      : parent_{parent},
+        target_{target},
+        in_memory_{in_memory},
+        match_id_{match_id} {
   }
 
-  // In the form `.some.next n`  <<---  parsed as VariantPattern
-  void VisitSingleStructPat(VariantPattern* node) {
-    if (auto& inner = node->inner_pat_) {
-      auto offset =
-          parent_.measure_.MeasureFieldOffset(node->type_, node->name_);
+  void Compile(std::vector<MatchRow> rows) {
+    if (rows.empty()) {
+      parent_.Jump("nomatch.{}", match_id_);
+      return;
+    }
 
-      auto new_addr = parent_.GenTemporary();
+    if (rows.front().tests.empty()) {
+      parent_.Jump("arm.{}.{}", match_id_, rows.front().arm);
+      return;
+    }
 
-      fmt::print("  {} = l add {}, {}  \n",  //
-                 new_addr.Emit(), target_id_.Emit(), offset);
+    auto test = rows.front().tests.front();
+    auto value = Load(test);
 
-      target_id_ = new_addr;
+    auto tests_path = [&](const MatchTest& t) {
+      return t.path == test.path;
+    };
 
-      inner->Accept(this);
+    // Distinct constants, in order of first appearance
+    std::vector<Case> cases;
+    std::unordered_map<std::string, size_t> index;
+
+    for (auto& row : rows) {
+      auto it = std::find_if(row.tests.begin(), row.tests.end(), tests_path);
+
+      if (it == row.tests.end()) {
+        continue;
+      }
+
+      auto key = fmt::format("{}", it->constant);
+
+      if (index.try_emplace(key, cases.size()).second) {
+        cases.push_back(Case{it->constant, parent_.id_ += 1});
+      }
+    }
+
+    auto exhaustive = test.alternatives == cases.size();
+    auto fallback = exhaustive ? -1 : parent_.id_ += 1;
+
+    auto sorted = std::all_of(cases.begin(), cases.end(), [](auto& c) {
+      return c.constant.tag == Value::CONST_INT;
+    });
+
+    auto order = cases;
+
+    if (sorted) {
+      std::sort(order.begin(), order.end(), [](auto& a, auto& b) {
+        return a.constant.value < b.constant.value;
+      });
+    }
+
+    if (sorted && order.size() > kMaxChain && IsDense(order, fallback)) {
+      parent_.match_stats_.dense_switches += 1;
+      Switch(value, test, order, fallback);
+    } else {
+      if (sorted && order.size() > kMaxChain) {
+        parent_.match_stats_.binary_searches += 1;
+      } else {
+        parent_.match_stats_.compare_chains += 1;
+      }
+
+      Search(value, test, order, sorted, fallback);
+    }
+
+    // Every row either agrees with the case, or does not look at the value
+
+    for (auto& c : cases) {
+      std::vector<MatchRow> branch;
+      auto key = fmt::format("{}", c.constant);
+
+      for (auto& row : rows) {
+        auto it = std::find_if(row.tests.begin(), row.tests.end(), tests_path);
+
+        if (it == row.tests.end()) {
+          branch.push_back(row);
+        } else if (fmt::format("{}", it->constant) == key) {
+          branch.push_back(row);
+          branch.back().tests.erase(branch.back().tests.begin() +
+                                    (it - row.tests.begin()));
+        }
+      }
+
+      parent_.Label("case.{}", c.label);
+      Compile(std::move(branch));
+    }
+
+    if (!exhaustive) {
+      std::erase_if(rows, [&](auto& row) {
+        return std::any_of(row.tests.begin(), row.tests.end(), tests_path);
+      });
+
+      parent_.Label("case.{}", fallback);
+      Compile(std::move(rows));
     }
   }
 
-  void VisitVariantPat(VariantPattern* node) {
-    auto ty = node->GetType();
+ private:
+  // Longest run of cases compared one by one
+  static constexpr size_t kMaxChain = 3;
+
+  struct Case {
+    Value constant;
+    int label;
+  };
+
+  // Offsets from the lowest constant on, up to the next run
+  struct Run {
+    int64_t first;
+    int label;
+  };
+
+  Value Load(const MatchTest& test) {
+    if (!in_memory_) {
+      return target_;
+    }
 
-    if (ty->tag == types::TypeTag::TY_STRUCT) {
-      VisitSingleStructPat(node);
-      return;
+    auto addr = target_;
+
+    if (test.offset != 0) {
+      addr = parent_.GenTemporary();
+      parent_.Print("  {} =l add {}, {}\n", addr, target_, test.offset);
     }
 
-    auto discr_pat =
-        parent_.GenConstInt(parent_.measure_.SumDiscriminant(ty, node->name_));
+    auto out = parent_.GenTemporary();
 
-    auto memory = parent_.GenTemporary();
-    fmt::print("  {} =w loadsw {}  \n", memory.Emit(), target_id_.Emit());
+    if (test.type) {
+      parent_.Print("  {} ={} load{} {}\n",  //
+                    out, ToQbeType(test.type), LoadSuf(test.type), addr);
+    } else {
+      parent_.Print("  {} =w loadsw {}\n", out, addr);
+    }
+
+    return out;
+  }
+
+  // Short runs are compared one by one, longer ones split in halves.
+  // Without a fallback the last case needs no comparison.
+
+  void Search(Value value, const MatchTest& test, std::span<Case> cases,
+              bool sorted, int fallback) {
+    auto cls = test.type ? ToQbeType(test.type) : std::string_view{"w"};
+    auto sign = test.type && IsUnsigned(test.type) ? 'u' : 's';
+
+    if (!sorted || cases.size() <= kMaxChain) {
+      for (size_t i = 0; i < cases.size(); i++) {
+        if (i + 1 == cases.size() && fallback < 0) {
+          parent_.Jump("case.{}", cases[i].label);
+          return;
+        }
+
+        auto next = parent_.id_ += 1;
+        auto condition = parent_.GenTemporary();
 
+        parent_.Print("  {} =w ceq{} {}, {}\n",  //
+                      condition, cls, value, cases[i].constant);
+        parent_.Branch(condition, fmt::format("case.{}", cases[i].label),
+                       fmt::format("case.{}", next));
+        parent_.Label("case.{}", next);
+      }
+
+      parent_.Jump("case.{}", fallback);
+      return;
+    }
+
+    auto mid = cases.size() / 2;
+    auto lower = parent_.id_ += 1;
+    auto upper = parent_.id_ += 1;
     auto condition = parent_.GenTemporary();
-    fmt::print("  {} =w ceqw {}, {}\n",  //
-               condition.Emit(), discr_pat.Emit(), memory.Emit());
 
-    fmt::print("  jnz {}, @match.{}.check.{}, @match.{}\n",  //
-               condition.Emit(), next_arm_ - 1, check++, next_arm_);
+    parent_.Print("  {} =w c{}lt{} {}, {}\n",  //
+                  condition, sign, cls, value, cases[mid].constant);
+    parent_.Branch(condition, fmt::format("case.{}", lower),
+                   fmt::format("case.{}", upper));
 
-    fmt::print("@match.{}.check.{}\n", next_arm_ - 1, check - 1);
+    parent_.Label("case.{}", lower);
+    Search(value, test, cases.subspan(0, mid), sorted, fallback);
 
-    if (auto& inner = node->inner_pat_) {
-      auto new_addr = parent_.GenTemporary();
+    parent_.Label("case.{}", upper);
+    Search(value, test, cases.subspan(mid), sorted, fallback);
+  }
 
-      fmt::print("  {} = l add {}, {}  \n",  //
-                 new_addr.Emit(), target_id_.Emit(), 4);
+  // Holes go to the fallback, so at least half of the range has to come
+  // from the cases. Without a fallback there must be none.
 
-      target_id_ = new_addr;
+  static bool IsDense(std::span<Case> cases, int fallback) {
+    auto range = cases.back().constant.value - cases.front().constant.value;
+    auto size = int64_t(cases.size());
 
-      inner->Accept(this);
+    return fallback < 0 ? range + 1 == size : range + 1 <= 2 * size;
+  }
+
+  // Sorted cases without many holes are split by their offset from the
+  // lowest one: a single unsigned comparison rejects both ends of the
+  // range, and each leaf of the search is one run of offsets, reached
+  // with no equality test.
+
+  void Switch(Value value, const MatchTest& test, std::span<Case> cases,
+              int fallback) {
+    auto cls = test.type ? ToQbeType(test.type) : std::string_view{"w"};
+    auto low = cases.front().constant.value;
+
+    std::vector<Run> runs;
+
+    for (auto& c : cases) {
+      auto offset = c.constant.value - low;
+
+      if (!runs.empty() && runs.back().first + 1 < offset) {
+        runs.push_back({runs.back().first + 1, fallback});
+      }
+
+      runs.push_back({offset, c.label});
+    }
+
+    auto index = value;
+
+    if (low != 0) {
+      index = parent_.GenTemporary();
+      parent_.Print("  {} ={} sub {}, {}\n", index, cls, value, low);
+    }
+
+    if (fallback >= 0) {
+      auto range = runs.back().first + 1;
+      auto in_range = parent_.GenTemporary();
+      auto search = parent_.id_ += 1;
+
+      parent_.Print("  {} =w cult{} {}, {}\n", in_range, cls, index, range);
+      parent_.Branch(in_range, fmt::format("case.{}", search),
+                     fmt::format("case.{}", fallback));
+      parent_.Label("case.{}", search);
     }
+
+    SearchRuns(index, cls, runs);
+  }
+
+  void SearchRuns(Value index, std::string_view cls, std::span<Run> runs) {
+    if (runs.size() == 1) {
+      parent_.Jump("case.{}", runs.front().label);
+      return;
+    }
+
+    auto mid = runs.size() / 2;
+    auto lower = parent_.id_ += 1;
+    auto upper = parent_.id_ += 1;
+    auto condition = parent_.GenTemporary();
+
+    parent_.Print("  {} =w cult{} {}, {}\n",  //
+                  condition, cls, index, runs[mid].first);
+    parent_.Branch(condition, fmt::format("case.{}", lower),
+                   fmt::format("case.{}", upper));
+
+    parent_.Label("case.{}", lower);
+    SearchRuns(index, cls, runs.subspan(0, mid));
+
+    parent_.Label("case.{}", upper);
+    SearchRuns(index, cls, runs.subspan(mid));
   }
 
  private:
   IrEmitter& parent_;
 
-  Value target_id_;
-  bool literal_ = false;  // For those targets that are not held in memory
-
-  int next_arm_ = -1;
-  int check = 0;
-  std::string result_;
+  Value target_;
+  bool in_memory_;
+  int match_id_;
 };
 
+//////////////////////////////////////////////////////////////////////
+
 }  // namespace qbe
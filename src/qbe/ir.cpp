@@ -0,0 +1,42 @@
+#include <qbe/ir.hpp>
+
+namespace qbe::ir {
+
+////////////////////////////////////////////////////////////////////
+
+void Serialize(const Function& fn, fmt::memory_buffer& out) {
+  auto it = std::back_inserter(out);
+
+  fmt::format_to(it, "{}\n", fn.header);
+
+  for (auto& block : fn.blocks) {
+    fmt::format_to(it, "@{}\n", block.label);
+    out.append(block.code.data(), block.code.data() + block.code.size());
+
+    if (!block.jump) {
+      continue;
+    }
+
+    fmt::format_to(it, "  {}", block.jump->op);
+
+    auto sep = " ";
+
+    if (!block.jump->operand.empty()) {
+      fmt::format_to(it, " {}", block.jump->operand);
+      sep = ", ";
+    }
+
+    for (auto& target : block.jump->targets) {
+      fmt::format_to(it, "{}@{}", sep, target);
+      sep = ", ";
+    }
+
+    fmt::format_to(it, "\n");
+  }
+
+  fmt::format_to(it, "}}\n\n");
+}
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe::ir
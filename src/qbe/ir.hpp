@@ -0,0 +1,42 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace qbe::ir {
+
+//////////////////////////////////////////////////////////////////////
+
+// A QBE function split into blocks, so that passes can look at the
+// control flow before the text is written out. The emitter builds it as
+// it goes: straight-line code is kept as printed, jumps are structured.
+
+struct Jump {
+  std::string op;                    // jmp, jnz, ret or hlt
+  std::string operand;               // Condition of jnz, value of ret
+  std::vector<std::string> targets;  // Labels, without `@`
+};
+
+struct Block {
+  std::string label;  // Without `@`
+  std::string code;   // Instructions before the jump, one per line
+
+  // Empty if the block falls through to the next one
+  std::optional<Jump> jump;
+};
+
+struct Function {
+  std::string header;  // Everything up to and including the `{`
+  std::vector<Block> blocks;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+void Serialize(const Function& fn, fmt::memory_buffer& out);
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe::ir
@@ -4,7 +4,11 @@
 #include <qbe/gen_match.hpp>
 #include <qbe/gen_addr.hpp>
 #include <qbe/gen_at.hpp>
+#include <qbe/tail_calls.hpp>
+#include <qbe/address_taken.hpp>
 
+#include <algorithm>
+#include <map>
 #include <span>
 
 namespace qbe {
@@ -16,27 +20,50 @@ void IrEmitter::GenAddress(Expression* what, Value out) {
   what->Accept(&gen_addr);
 };
 
-void IrEmitter::GenAtAddress(Expression* what, Value where) {
+void IrEmitter::GenAtAddress(Expression* what, Value where, bool fresh) {
   if (measure_.IsZST(what->GetType())) {
     return;
   }
-  class GenAt gen_addr(*this, where);
+  class GenAt gen_addr(*this, where, fresh);
   what->Accept(&gen_addr);
 };
 
 ////////////////////////////////////////////////////////////////////
 
+// Scalars whose address is never taken need no stack slot, they are
+// assigned with copy and QBE builds the SSA form itself
+
+bool IrEmitter::InTemporary(VarDeclStatement* node) {
+  auto ty = node->value_->GetType();
+
+  return address_taken_ && !address_taken_->Contains(node->GetName()) &&
+         !measure_.IsCompound(ty) && !measure_.IsZST(ty);
+}
+
 void IrEmitter::VisitVarDecl(VarDeclStatement* node) {
+  if (InTemporary(node)) {
+    auto value = Eval(node->value_);
+    auto local = GenLocal();
+
+    PrintCopyInstruction(local, value, ToQbeType(node->value_->GetType()));
+    named_values_.insert_or_assign(node->GetName(), local);
+
+    locals_in_temporaries_ += 1;
+    return_value = Value::None();
+    return;
+  }
+
   auto address = GenTemporary();
   named_values_.insert_or_assign(node->GetName(), address);
 
   auto [size, alignment] = SizeAlign(node->value_);
-  fmt::print("# declare {}\n", node->GetName());
-  fmt::print("  {} =l alloc{} {}\n", address.Emit(), alignment, size);
+  PrintAlloc(address, alignment, size);
 
   // Gen at address handles big structures itself!
 
-  GenAtAddress(node->value_, address);
+  // The initializer may refer to the variable's own address
+  auto fresh = address_taken_ && !address_taken_->Contains(node->GetName());
+  GenAtAddress(node->value_, address, fresh);
 
   return_value = Value::None();
 }
@@ -44,6 +71,19 @@ void IrEmitter::VisitVarDecl(VarDeclStatement* node) {
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitAssignment(AssignmentStatement* node) {
+  if (auto var = node->target_->as<VarAccessExpression>()) {
+    auto it = named_values_.find(var->GetName());
+
+    if (it != named_values_.end() && it->second.tag == Value::LOCAL) {
+      auto local = it->second;
+      auto value = Eval(node->value_);
+
+      PrintCopyInstruction(local, value, ToQbeType(var->GetType()));
+      return_value = Value::None();
+      return;
+    }
+  }
+
   auto out = GenTemporary();
 
   GenAddress(node->target_, out);
@@ -62,51 +102,104 @@ bool IsTest(Attribute* attr) {
   return attr && attr->FindAttr("test");
 }
 
-void IrEmitter::VisitFunDecl(FunDeclStatement* node) {
-  if (!node->body_) {
-    return;
-  }
+// The dot separates the name from the mangled type, it can't occur in either
+
+std::string InstanceName(std::string_view name, types::Type* type) {
+  return FitName(fmt::format("{}.{}", name, types::Mangle(*type)));
+}
 
-  auto mangled = std::string(node->GetName());
+std::string IrEmitter::FunctionName(FunDeclStatement* node) {
   auto symbol = node->layer_->RetrieveSymbol(node->GetName());
 
-  if (!IsNomangle(symbol->as_fn_sym.attrs) &&
-      !IsTest(symbol->as_fn_sym.attrs)) {
-    mangled += types::Mangle(*node->type_);
+  if (IsNomangle(symbol->as_fn_sym.attrs) || IsTest(symbol->as_fn_sym.attrs)) {
+    return std::string(node->GetName());
   }
 
-  auto qbe_ty = ToQbeType(node->type_->as_fun.result_type);
-  fmt::print("export function {} ${} (", qbe_ty, mangled);
+  return InstanceName(node->GetName(), node->type_);
+}
+
+std::vector<Value> IrEmitter::PrintHeader(FunDeclStatement* node,
+                                          std::string_view name) {
+  auto result = node->type_->as_fun.result_type;
+
+  if (ReturnsInSlot(result, HasCName(node))) {
+    result_slot_ = GenParam();
+    Print("export function ${} (l {}, ", name, result_slot_);
+  } else {
+    result_slot_ = Value::None();
+    Print("export function {} ${} (", ToQbeType(result), name);
+  }
 
   auto& arg_ty = node->type_->as_fun.param_pack;
   auto& formals = node->formals_;
 
+  std::vector<Value> params;
+
   for (size_t i = 0; i < arg_ty.size(); i++) {
     auto t = GenParam();
     named_values_.insert_or_assign(formals[i].GetName(), t);
+    params.push_back(t);
 
     // Do not even mention zsts in the args
     if (measure_.IsZST(arg_ty[i])) {
       continue;
     }
 
-    fmt::print("{} {}, ", ToQbeType(arg_ty[i]), t.Emit());
+    Print("{} {}, ", ToQbeType(arg_ty[i]), t);
   }
 
-  fmt::print(") {{ \n");
-  fmt::print("@start\n");
-
-  auto out = Eval(node->body_);
+  Print(") {{");
+  return params;
+}
 
-  fmt::print("@ret\n");
-  fmt::print("  ret {}\n", out.Emit());
-  fmt::print("}}\n\n");
+void IrEmitter::RegisterTest(FunDeclStatement* node) {
+  auto symbol = node->layer_->RetrieveSymbol(node->GetName());
 
   if (IsTest(symbol->as_fn_sym.attrs)) {
     test_functions_.push_back(node->GetName());
   }
 }
 
+void IrEmitter::VisitFunDecl(FunDeclStatement* node) {
+  if (!node->body_) {
+    return;
+  }
+
+  auto mangled = FunctionName(node);
+
+  // Only instances may be folded, others can be referred to by name
+  auto layout = mangled != node->GetName() ? LayoutSignature(node->type_)
+                                           : std::string{};
+
+  // Temporaries and labels are local to a function
+  Commit();
+  id_ = 0;
+
+  TailCalls tail_calls{node, measure_};
+  tail_calls_ = &tail_calls;
+  function_name_ = mangled;
+
+  AddressTaken address_taken{node};
+  address_taken_ = &address_taken;
+
+  entries_.clear();
+  auto& entry = entries_[mangled];
+
+  entry.label = "loop";
+  entry.params = PrintHeader(node, mangled);
+
+  OpenBody();
+  PrintReturn(node->body_);
+
+  SpliceEntry(entry.used ? "loop" : "");
+  tail_calls_ = nullptr;
+  address_taken_ = nullptr;
+
+  Commit(std::move(mangled), std::move(layout));
+
+  RegisterTest(node);
+}
+
 ////////////////////////////////////////////////////////////////////
 
 bool IsFunctional(ast::scope::Symbol* symbol) {
@@ -119,15 +212,22 @@ char GlobalFun(ast::scope::Symbol* symbol) {
 }
 
 void IrEmitter::VisitFnCall(FnCallExpression* node) {
-  auto out = measure_.IsZST(node->GetType()) ? Value::None() : GenTemporary();
+  if (!ReturnsInSlot(node->GetType(), HasCName(node))) {
+    return_value = EmitCall(node, Value::None());
+    return;
+  }
 
-  // %out = call $rt.memset(l %binding.5, l 0, l 8)
-  fmt::print("# call {}\n", node->GetFunctionName());
+  auto slot = GenTemporary();
+  auto [size, alignment] = SizeAlign(node);
+  PrintAlloc(slot, alignment, size);
 
-  struct Arg {
-    Value v;
-    std::string qbe_ty;
-  };
+  return_value = EmitCall(node, slot);
+}
+
+Value IrEmitter::EmitCall(FnCallExpression* node, Value slot) {
+  auto in_slot = slot.tag != Value::NONE;
+  auto out = in_slot || measure_.IsZST(node->GetType()) ? Value::None()
+                                                         : GenTemporary();
 
   std::vector<Arg> args;
   for (auto& a : node->arguments_) {
@@ -136,41 +236,211 @@ void IrEmitter::VisitFnCall(FnCallExpression* node) {
 
   // If there are struct args, I need to allocate space for them and copy there
 
-  auto mangled = std::string(node->GetFunctionName());
   auto symbol = node->layer_->RetrieveSymbol(node->GetFunctionName());
+  auto mangled = IsFunctional(symbol)
+                     ? CalleeName(node)
+                     : named_values_[node->GetFunctionName()].Emit();
 
-  if (!IsFunctional(symbol)) {
-    mangled = named_values_[mangled].Emit();
-  } else if (!IsNomangle(symbol->as_fn_sym.attrs) &&
-             !IsTest(symbol->as_fn_sym.attrs)) {
-    mangled += types::Mangle(*node->callable_type_);
+  // The slot of a tail call has to be the one of the caller
+  if (IsFunctional(symbol) && IsTailJump(node, mangled) &&
+      slot.tag == result_slot_.tag && slot.id == result_slot_.id) {
+    JumpToEntry(node, args, entries_.at(mangled));
+
+    if (in_slot || measure_.IsZST(node->GetType())) {
+      return slot;
+    }
+    return GenConstInt(0);
   }
 
-  if (measure_.IsZST(node->GetType())) {
-    fmt::print("  call {}{} ( ", GlobalFun(symbol), mangled);
+  if (in_slot) {
+    Print("  call {}{} (l {}, ", GlobalFun(symbol), mangled, slot);
+  } else if (measure_.IsZST(node->GetType())) {
+    Print("  call {}{} ( ", GlobalFun(symbol), mangled);
   } else {
     auto result_ty = ToQbeType(node->GetType());
-    fmt::print("  {} = {} call {}{} ( ", out.Emit(), result_ty,
-               GlobalFun(symbol), mangled);
+    Print("  {} = {} call {}{} ( ", out, result_ty, GlobalFun(symbol), mangled);
   }
 
   for (auto& i : args) {
     if (i.v.tag == Value::NONE) {
       continue;
     }
-    fmt::print("{} {}, ", i.qbe_ty, i.v.Emit());
+    Print("{} {}, ", i.qbe_ty, i.v);
   }
 
-  fmt::print(")\n");
+  Print(")\n");
 
-  return_value = out;
+  return in_slot ? slot : out;
 }
 
 ////////////////////////////////////////////////////////////////////
 
-void IrEmitter::VisitIntrinsic(IntrinsicCall* node) {
-  fmt::print("# Call intrinsic {}\n", node->GetFunctionName());
+std::string IrEmitter::CalleeName(FnCallExpression* node) {
+  auto symbol = node->layer_->RetrieveSymbol(node->GetFunctionName());
+
+  if (!IsFunctional(symbol)) {
+    return {};
+  }
+
+  if (IsNomangle(symbol->as_fn_sym.attrs) || IsTest(symbol->as_fn_sym.attrs)) {
+    return std::string(node->GetFunctionName());
+  }
+
+  return InstanceName(node->GetFunctionName(), node->callable_type_);
+}
+
+bool IrEmitter::HasCName(FunDeclStatement* node) {
+  return FunctionName(node) == node->GetName();
+}
+
+// Calls through a pointer reach instances
+
+bool IrEmitter::HasCName(FnCallExpression* node) {
+  return CalleeName(node) == node->GetFunctionName();
+}
+
+// A call in tail position to a function emitted into the same QBE
+// function (itself, or a member of its tail-call group) becomes a jump
+// to its entry. Aggregates are passed by address, so only parameters
+// may be forwarded, the rest of the frame is reused.
+
+bool IrEmitter::IsTailJump(FnCallExpression* node, std::string_view mangled) {
+  auto target = entries_.find(std::string{mangled});
+
+  if (target == entries_.end() || !tail_calls_->IsTailCall(node) ||
+      tail_calls_->FrameEscapes()) {
+    return false;
+  }
+
+  auto& params = entries_.at(function_name_).params;
 
+  for (auto a : node->arguments_) {
+    if (!measure_.IsCompound(a->GetType())) {
+      continue;
+    }
+
+    auto access = a->as<VarAccessExpression>();
+
+    if (!access || !named_values_.contains(access->GetName())) {
+      return false;
+    }
+
+    auto value = named_values_.at(access->GetName());
+
+    if (std::none_of(params.begin(), params.end(), [&](auto& p) {
+          return p.tag == value.tag && p.id == value.id;
+        })) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void IrEmitter::JumpToEntry(FnCallExpression* node, std::span<Arg> args,
+                            Entry& target) {
+  // All arguments are read before any parameter is overwritten
+  std::vector<std::pair<Value, std::string_view>> staged;
+
+  for (size_t i = 0; i < args.size(); i++) {
+    if (args[i].v.tag == Value::NONE) {
+      staged.emplace_back(Value::None(), "");
+      continue;
+    }
+
+    auto temp = GenTemporary();
+    auto suf = CopySuf(node->arguments_[i]->GetType());
+    Print("  {} ={} copy {}\n", temp, suf, args[i].v);
+    staged.emplace_back(temp, suf);
+  }
+
+  for (size_t i = 0; i < staged.size(); i++) {
+    PrintCopyInstruction(target.params[i], staged[i].first, staged[i].second);
+  }
+
+  Jump("{}", target.label);
+  Label("block{}", id_ += 1);
+
+  target.used = true;
+}
+
+// Allocations are moved to the start block, where QBE gives them fixed
+// slots. This also keeps the stack flat when the body is a loop.
+
+void IrEmitter::SpliceEntry(std::string_view label) {
+  CloseCode();
+
+  auto& start = function_.blocks.front();
+  auto allocs = fmt::to_string(allocs_);
+  allocs_.clear();
+
+  if (label.empty()) {
+    start.code.insert(0, allocs);
+    return;
+  }
+
+  // Tail calls jump back to the body, below the allocations
+  ir::Block body{
+      .label = std::string{label},
+      .code = std::move(start.code),
+      .jump = std::move(start.jump),
+  };
+
+  start.code = std::move(allocs);
+  start.jump.reset();
+
+  function_.blocks.insert(function_.blocks.begin() + 1, std::move(body));
+}
+
+////////////////////////////////////////////////////////////////////
+
+// The header printed so far is the function's, its body starts with
+// the entry block
+
+void IrEmitter::OpenBody() {
+  function_ = ir::Function{.header = fmt::to_string(buffer_), .blocks = {}};
+  buffer_.clear();
+
+  Label("start");
+}
+
+void IrEmitter::CloseCode() {
+  if (buffer_.size() == 0) {
+    return;
+  }
+
+  auto& block = function_.blocks.back();
+  FMT_ASSERT(!block.jump, "Code after a jump");
+
+  block.code.append(buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+void IrEmitter::EndBlock(ir::Jump jump) {
+  CloseCode();
+
+  auto& block = function_.blocks.back();
+  FMT_ASSERT(!block.jump, "Two jumps in a block");
+
+  block.jump = std::move(jump);
+}
+
+void IrEmitter::Commit(std::string name, std::string layout) {
+  if (!name.empty()) {
+    CloseCode();
+    passes_.Run(function_);
+    ir::Serialize(function_, buffer_);
+  }
+
+  chunks_.push_back(Chunk{.text = fmt::to_string(buffer_),
+                          .name = std::move(name),
+                          .layout = std::move(layout)});
+  buffer_.clear();
+}
+
+////////////////////////////////////////////////////////////////////
+
+void IrEmitter::VisitIntrinsic(IntrinsicCall* node) {
   switch (node->intrinsic) {
     case ast::elaboration::Intrinsic::PRINT:
       CallPrintf(node);
@@ -180,6 +450,17 @@ void IrEmitter::VisitIntrinsic(IntrinsicCall* node) {
       CheckAssertion(node->arguments_[0]);
       break;
 
+    case ast::elaboration::Intrinsic::DELETE:
+      Print("  call ${} (l {})\n",  //
+            pool_allocator_ ? "et_free" : "free", Eval(node->arguments_[0]));
+      break;
+
+    case ast::elaboration::Intrinsic::SIZE_OF: {
+      auto ptr = node->arguments_[0]->GetType();
+      return_value = GenConstInt(GetTypeSize(ptr->as_ptr.underlying));
+      return;
+    }
+
     default:
       std::abort();
   }
@@ -190,10 +471,31 @@ void IrEmitter::VisitIntrinsic(IntrinsicCall* node) {
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitReturn(ReturnStatement* node) {
-  auto returning = Eval(node->return_value_);
+  PrintReturn(node->return_value_);
+  Label("block{}", id_ += 1);
+
+  return_value = Value::None();
+}
+
+// Compound results go to the caller's slot, the rest is returned
 
-  fmt::print("  ret {}\n", returning.Emit());
-  fmt::print("@block{}\n", id_ += 1);
+void IrEmitter::PrintReturn(Expression* value) {
+  if (result_slot_.tag == Value::NONE) {
+    Return(Eval(value));
+    return;
+  }
+
+  GenAtAddress(value, result_slot_, true);
+  Return(Value::None());
+}
+
+////////////////////////////////////////////////////////////////////
+
+void IrEmitter::VisitLoopControl(LoopControlStatement* node) {
+  FMT_ASSERT(!loops_.empty(), "Loop control outside of a loop");
+
+  Jump("{}.{}", node->IsBreak() ? "done" : "next", loops_.back());
+  Label("block{}", id_ += 1);
 
   return_value = Value::None();
 }
@@ -230,8 +532,8 @@ void IrEmitter::VisitDeref(DereferenceExpression* node) {
   }
 
   auto temp = GenTemporary();
-  fmt::print("  {} = {} load{} {}  \n", temp.Emit(), ToQbeType(node->GetType()),
-             LoadSuf(node->GetType()), src.Emit());
+  Print("  {} = {} load{} {}  \n", temp, ToQbeType(node->GetType()),
+        LoadSuf(node->GetType()), src);
   return_value = temp;
 }
 
@@ -250,37 +552,43 @@ void IrEmitter::VisitComparison(ComparisonExpression* node) {
   auto left = Eval(node->left_);
   auto right = Eval(node->right_);
 
+  auto type = node->left_->GetType();
+  auto cls = ToQbeType(type);
+
+  // Floats are always signed and have no prefix for it
+  auto sign = IsFloat(type)      ? ""
+              : IsUnsigned(type) ? "u"
+                                 : "s";
+
   switch (node->operator_.type) {
     case lex::TokenType::EQUALS:
-      fmt::print("  {} =w ceq{} {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->left_->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} =w ceq{} {}, {}\n",  //
+            out, cls, left, right);
       break;
 
     case lex::TokenType::NOT_EQ:
-      fmt::print("  {} =w cne{} {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->left_->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} =w cne{} {}, {}\n",  //
+            out, cls, left, right);
       break;
 
     case lex::TokenType::LT:
-      fmt::print("  {} =w csltw {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}lt{} {}, {}\n",  //
+            out, sign, cls, left, right);
       break;
 
     case lex::TokenType::GE:
-      fmt::print("  {} =w csgew {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}ge{} {}, {}\n",  //
+            out, sign, cls, left, right);
       break;
 
     case lex::TokenType::LE:
-      fmt::print("  {} =w cslew {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}le{} {}, {}\n",  //
+            out, sign, cls, left, right);
       break;
 
     case lex::TokenType::GT:
-      fmt::print("  {} =w csgtw {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} =w c{}gt{} {}, {}\n",  //
+            out, sign, cls, left, right);
       break;
 
     default:
@@ -297,47 +605,57 @@ void IrEmitter::VisitBinary(BinaryExpression* node) {
   auto left = Eval(node->left_);
   auto right = Eval(node->right_);
 
-  // Handle pointer arithmetic
-
-  if (node->left_->GetType()->tag == types::TypeTag::TY_PTR) {
-    auto ptr_type = node->left_->GetType();
+  // An Int offset is widened to a long one
 
-    auto underlying = ptr_type->as_ptr.underlying;
-    auto multiplier = GetTypeSize(underlying);
+  auto left_type = node->left_->GetType();
 
+  if (ToQbeType(left_type) == "l" &&
+      node->right_->GetType()->tag == types::TypeTag::TY_INT) {
     auto temp = GenTemporary();
-    fmt::print("  {} =l extuw {}\n", temp.Emit(), right.Emit());
+    Print("  {} =l extsw {}\n", temp, right);
+    right = temp;
+  }
+
+  // Handle pointer arithmetic
+
+  if (left_type->tag == types::TypeTag::TY_PTR) {
+    auto multiplier = GetTypeSize(left_type->as_ptr.underlying);
 
     if (multiplier != 1) {
-      fmt::print("  {} =l mul {}, {}\n",  //
-                 temp.Emit(), temp.Emit(), multiplier);
+      auto temp = GenTemporary();
+      Print("  {} =l mul {}, {}\n",  //
+            temp, right, multiplier);
+      right = temp;
     }
-
-    right = temp;
   }
 
   switch (node->operator_.type) {
     case lex::TokenType::PLUS:
-      fmt::print("  {} = {} add {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} = {} add {}, {}\n",  //
+            out, ToQbeType(node->GetType()), left, right);
       break;
 
     case lex::TokenType::MINUS:
-      fmt::print("  {} = {} sub {}, {}\n",  //
-                 out.Emit(), ToQbeType(node->GetType()), left.Emit(),
-                 right.Emit());
+      Print("  {} = {} sub {}, {}\n",  //
+            out, ToQbeType(node->GetType()), left, right);
       break;
 
     case lex::TokenType::STAR:
-      fmt::print("  {} =w mul {}, {}\n",  //
-                 out.Emit(), left.Emit(), right.Emit());
+      Print("  {} ={} mul {}, {}\n",  //
+            out, ToQbeType(node->GetType()), left, right);
+      break;
+
+    case lex::TokenType::DIV:
+      Print("  {} ={} {} {}, {}\n",  //
+            out, ToQbeType(node->GetType()),
+            IsUnsigned(node->GetType()) ? "udiv" : "div", left, right);
       break;
 
     default:
       FMT_ASSERT(false, "Unreachable!");
   }
 
+  KeepExtended(out, node->GetType());
   return_value = out;
 }
 
@@ -346,13 +664,14 @@ void IrEmitter::VisitUnary(UnaryExpression* node) {
 
   switch (node->operator_.type) {
     case lex::TokenType::MINUS:
-      fmt::print("  {} =w neg {}    \n",  //
-                 out.Emit(), Eval(node->operand_).Emit());
+      Print("  {} ={} neg {}    \n",  //
+            out, ToQbeType(node->GetType()), Eval(node->operand_));
+      KeepExtended(out, node->GetType());
       break;
 
     case lex::TokenType::NOT:
-      fmt::print("  {} =w ceqw {}, 0\n",  //
-                 out.Emit(), Eval(node->operand_).Emit());
+      Print("  {} =w ceqw {}, 0\n",  //
+            out, Eval(node->operand_));
       break;
 
     default:
@@ -364,45 +683,203 @@ void IrEmitter::VisitUnary(UnaryExpression* node) {
 
 ////////////////////////////////////////////////////////////////////
 
-void PrintCopyInstruction(Value out, Value res, std::string_view assign) {
+// Integers narrower than a word are held extended to the whole word, so
+// that comparing and widening them can look at all of its bits
+
+void IrEmitter::KeepExtended(Value value, types::Type* type) {
+  if (auto bits = IntegerBits(type); bits && bits < 32) {
+    Print("  {} =w ext{} {}\n", value, LoadSuf(type), value);
+  }
+}
+
+// Truncates to a narrower type, or extends as the source type says
+
+Value IrEmitter::ConvertInteger(Value value, types::Type* from,
+                                types::Type* to) {
+  auto from_bits = IntegerBits(from);
+  auto to_bits = IntegerBits(to);
+  auto out = GenTemporary();
+
+  if (to_bits < 32 && to_bits <= from_bits) {
+    Print("  {} =w ext{} {}\n", out, LoadSuf(to), value);
+  } else if (from_bits < to_bits) {
+    Print("  {} ={} ext{} {}\n", out, ToQbeType(to), LoadSuf(from), value);
+  } else {
+    // The same bits, or the lower word of a long
+    Print("  {} ={} copy {}\n", out, ToQbeType(to), value);
+  }
+
+  return out;
+}
+
+// Between two floats, or a float and an integer, which goes through
+// its whole word or long
+
+Value IrEmitter::ConvertFloat(Value value, types::Type* from,
+                              types::Type* to) {
+  auto out = GenTemporary();
+  auto cls = ToQbeType(to);
+
+  if (IsFloat(from) && IsFloat(to)) {
+    auto op = from->tag == to->tag                ? "copy"
+              : to->tag == types::TypeTag::TY_F64 ? "exts"
+                                                  : "truncd";
+    Print("  {} ={} {} {}\n", out, cls, op, value);
+  } else if (IsFloat(to)) {
+    Print("  {} ={} {}{}tof {}\n",  //
+          out, cls, IsUnsigned(from) ? 'u' : 's',
+          IntegerBits(from) == 64 ? 'l' : 'w', value);
+  } else {
+    Print("  {} ={} {}to{}i {}\n",  //
+          out, cls, ToQbeType(from), IsUnsigned(to) ? 'u' : 's', value);
+    KeepExtended(out, to);
+  }
+
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void IrEmitter::PrintCopyInstruction(Value out, Value res,
+                                     std::string_view assign) {
   if (res.tag != Value::NONE) {
-    fmt::print("  {} = {} copy {}   \n", out.Emit(), assign, res.Emit());
+    Print("  {} = {} copy {}   \n", out, assign, res);
   }
 }
 
 ////////////////////////////////////////////////////////////////////
 
+// Small aggregates are copied with straight-line moves, medium ones with
+// a loop and the rest by memcpy. Moves are as wide as the remaining size
+// allows, every QBE target handles unaligned ones.
+
+static constexpr size_t kUnrolledCopy = 64;
+static constexpr size_t kLoopedCopy = 256;
+
+void IrEmitter::Copy(size_t size, Value src, Value dst) {
+  if (size > kLoopedCopy) {
+    Print("  call $memcpy (l {}, l {}, l {})\n", dst, src, size);
+    return;
+  }
+
+  auto src_ptr = GenTemporary();
+  auto dst_ptr = GenTemporary();
+
+  Print("  {} =l copy {}\n", src_ptr, src);
+  Print("  {} =l copy {}\n", dst_ptr, dst);
+
+  if (size > kUnrolledCopy) {
+    auto copy_id = id_ += 1;
+    auto end = GenTemporary();
+    auto more = GenTemporary();
+
+    Print("  {} =l add {}, {}\n", end, src_ptr, size / 8 * 8);
+    Label("copy.{}", copy_id);
+    CopyMove(8, src_ptr, dst_ptr);
+    Print("  {} =w cultl {}, {}\n", more, src_ptr, end);
+    Branch(more, fmt::format("copy.{}", copy_id),
+           fmt::format("copy_end.{}", copy_id));
+    Label("copy_end.{}", copy_id);
+
+    size %= 8;
+  }
+
+  for (size_t width : {8, 4, 1}) {
+    for (; size >= width; size -= width) {
+      CopyMove(width, src_ptr, dst_ptr);
+    }
+  }
+}
+
+// Moves `width` bytes and advances both pointers
+
+void IrEmitter::CopyMove(size_t width, Value src_ptr, Value dst_ptr) {
+  auto temp = GenTemporary();
+
+  Print("  {} ={} load{} {}\n",  //
+        temp, LoadResult(width), GetLoadSuf(width), src_ptr);
+  Print("  store{} {}, {}\n", GetStoreSuf(width), temp, dst_ptr);
+
+  Print("  {} =l add {}, {}\n", src_ptr, src_ptr, width);
+  Print("  {} =l add {}, {}\n", dst_ptr, dst_ptr, width);
+}
+
+////////////////////////////////////////////////////////////////////
+
 void IrEmitter::VisitIf(IfExpression* node) {
+  return_value = EmitIf(node, Value::None(), false);
+}
+
+Value IrEmitter::EmitIf(IfExpression* node, Value dest, bool fresh) {
   auto true_id = id_ += 1;
   auto false_id = id_ += 1;
   auto join_id = id_ += 1;
 
-  auto out = measure_.IsZST(node->GetType()) ? Value::None() : GenTemporary();
+  auto in_place = dest.tag != Value::NONE;
+  auto out = in_place || measure_.IsZST(node->GetType()) ? Value::None()
+                                                         : GenTemporary();
   auto condition = Eval(node->condition_);
+  auto assign = CopySuf(node->GetType());
 
-  fmt::print("#if-start\n");
-  fmt::print("  jnz {}, @true.{}, @false.{}\n",  //
-             condition.Emit(), true_id, false_id);
+  auto arm = [&](Expression* branch) {
+    if (in_place && !measure_.IsZST(branch->GetType())) {
+      GenAtAddress(branch, dest, fresh);
+    } else {
+      PrintCopyInstruction(out, Eval(branch), assign);
+    }
+  };
 
-  fmt::print("@true.{}          \n", true_id);
-  auto true_v = Eval(node->true_branch_);
-  auto assign = CopySuf(node->GetType());
+  Branch(condition, fmt::format("true.{}", true_id),
+         fmt::format("false.{}", false_id));
 
-  PrintCopyInstruction(out, true_v, assign);
-  fmt::print("  jmp @join.{}    \n", join_id);
+  Label("true.{}", true_id);
+  arm(node->true_branch_);
+  Jump("join.{}", join_id);
 
-  fmt::print("@false.{}         \n", false_id);
-  auto false_v = Eval(node->false_branch_);
+  Label("false.{}", false_id);
+  arm(node->false_branch_);
+  Label("join.{}", join_id);
 
-  PrintCopyInstruction(out, false_v, assign);
-  fmt::print("@join.{}          \n", join_id);
+  return out;
+}
 
-  return_value = out;
+////////////////////////////////////////////////////////////////////
+
+// Variables live in stack slots, so the blocks need no phis
+
+void IrEmitter::VisitWhile(WhileExpression* node) {
+  auto loop_id = id_ += 1;
+
+  Label("while.{}", loop_id);
+  auto condition = Eval(node->condition_);
+  Branch(condition, fmt::format("body.{}", loop_id),
+         fmt::format("done.{}", loop_id));
+
+  Label("body.{}", loop_id);
+
+  loops_.push_back(loop_id);
+  Eval(node->body_);  // unused
+  loops_.pop_back();
+
+  Label("next.{}", loop_id);
+
+  if (node->step_) {
+    node->step_->Accept(this);
+  }
+
+  Jump("while.{}", loop_id);
+  Label("done.{}", loop_id);
+
+  return_value = Value::None();
 }
 
 ////////////////////////////////////////////////////////////////////
 
 void IrEmitter::VisitMatch(MatchExpression* node) {
+  return_value = EmitMatch(node, Value::None(), false);
+}
+
+Value IrEmitter::EmitMatch(MatchExpression* node, Value dest, bool fresh) {
   auto assign = CopySuf(node->GetType());
 
   auto target = Eval(node->against_);
@@ -413,33 +890,169 @@ void IrEmitter::VisitMatch(MatchExpression* node) {
                        CopySuf(node->against_->GetType()));
   target = materialized;
 
-  auto out = measure_.IsZST(node->GetType()) ? Value::None() : GenTemporary();
-  auto end_id = id_ += 1;
+  auto in_place = dest.tag != Value::NONE;
+  auto out = in_place || measure_.IsZST(node->GetType()) ? Value::None()
+                                                         : GenTemporary();
+  auto match_id = id_ += 1;
 
-  auto match_arm = id_ += 1;
-  auto next_arm = id_ += 1;
+  if (!in_place && EmitMatchTable(node, target, out, match_id)) {
+    return out;
+  }
 
-  for (auto& [pat, expr] : node->patterns_) {
-    auto lit = !measure_.IsCompound(node->against_->GetType());
-    GenMatch match{*this, target, next_arm, lit};
+  std::vector<MatchRow> rows;
 
-    fmt::print("@match.{}          \n", match_arm);
-    pat->Accept(&match);
+  for (auto& [pat, _] : node->patterns_) {
+    auto& row = rows.emplace_back();
+    row.arm = rows.size() - 1;
 
-    auto res = Eval(expr);
-    PrintCopyInstruction(out, res, assign);
+    GenMatch flatten{*this, row};
+    pat->Accept(&flatten);
+  }
+
+  auto in_memory = measure_.IsCompound(node->against_->GetType());
+  DecisionTree{*this, target, in_memory, match_id}.Compile(rows);
+
+  for (auto& row : rows) {
+    Label("arm.{}.{}", match_id, row.arm);
+
+    for (auto& [name, offset] : row.bindings) {
+      auto bound = in_memory ? target : target.AsPattern();
+
+      if (offset != 0) {
+        bound = GenTemporary();
+        Print("  {} =l add {}, {}\n", bound, target, offset);
+      }
 
-    fmt::print("  jmp @match_end.{}    \n", end_id);
+      named_values_.insert_or_assign(name, bound);
+    }
+
+    auto expr = node->patterns_[row.arm].second;
 
-    match_arm = next_arm;
-    next_arm = id_ += 1;
+    if (in_place && !measure_.IsZST(expr->GetType())) {
+      GenAtAddress(expr, dest, fresh);
+    } else {
+      PrintCopyInstruction(out, Eval(expr), assign);
+    }
+
+    Jump("match_end.{}", match_id);
   }
 
-  fmt::print("@match.{}          \n", match_arm);
+  Label("nomatch.{}", match_id);
   CallAbort(node);
-  fmt::print("@match_end.{}    \n", end_id);
+  Label("match_end.{}", match_id);
 
-  return_value = out;
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////
+
+// Dense tables pay off from a few cases on. Holes cost a word each, so
+// at least half of the table has to come from the arms.
+static constexpr size_t kMinTableCases = 4;
+
+// Matches whose arms run code go through the decision tree, which
+// dispatches on dense constants with a switch of its own.
+
+bool IrEmitter::EmitMatchTable(MatchExpression* node, Value target, Value out,
+                               int match_id) {
+  auto is_word = [](types::Type* ty) {
+    return ty->tag == types::TypeTag::TY_INT ||
+           ty->tag == types::TypeTag::TY_CHAR ||
+           ty->tag == types::TypeTag::TY_BOOL;
+  };
+
+  if (!is_word(node->against_->GetType()) || !is_word(node->GetType())) {
+    return false;
+  }
+
+  std::map<int, int> cases;  // Constant to result, the first arm wins
+  Expression* fallback = nullptr;
+
+  for (auto& [pat, expr] : node->patterns_) {
+    if (!expr->as<LiteralExpression>()) {
+      return false;
+    }
+
+    if (pat->as<DiscardingPattern>()) {
+      fallback = expr;
+      break;
+    }
+
+    auto literal = pat->as<LiteralPattern>();
+
+    if (!literal) {
+      return false;
+    }
+
+    auto key = Eval(literal->pat_);
+    auto result = Eval(expr);
+
+    if (key.tag != Value::CONST_INT || result.tag != Value::CONST_INT) {
+      return false;
+    }
+
+    cases.try_emplace(key.value, result.value);
+  }
+
+  if (cases.size() < kMinTableCases) {
+    return false;
+  }
+
+  auto low = cases.begin()->first;
+  auto range = size_t(int64_t(cases.rbegin()->first) - low + 1);
+
+  if (range > 2 * cases.size() || (!fallback && range != cases.size())) {
+    return false;
+  }
+
+  auto hole = fallback ? Eval(fallback) : GenConstInt(0);
+
+  if (hole.tag != Value::CONST_INT) {
+    return false;
+  }
+
+  std::vector<int> table(range, hole.value);
+
+  for (auto [key, result] : cases) {
+    table[key - low] = result;
+  }
+
+  auto table_id = match_tables_.size();
+  match_tables_.push_back(std::move(table));
+  match_stats_.lookup_tables += 1;
+
+  // One unsigned comparison rejects both ends of the range
+
+  auto index = GenTemporary();
+  auto in_range = GenTemporary();
+
+  Print("  {} =w sub {}, {}\n", index, target, low);
+  Print("  {} =w cultw {}, {}\n", in_range, index, range);
+  Branch(in_range, fmt::format("table.{}", match_id),
+         fmt::format("nomatch.{}", match_id));
+
+  auto offset = GenTemporary();
+  auto scaled = GenTemporary();
+  auto addr = GenTemporary();
+
+  Label("table.{}", match_id);
+  Print("  {} =l extuw {}\n", offset, index);
+  Print("  {} =l mul {}, 4\n", scaled, offset);
+  Print("  {} =l add $match_table.{}, {}\n", addr, table_id, scaled);
+  Print("  {} =w loadsw {}\n", out, addr);
+  Jump("match_end.{}", match_id);
+
+  Label("nomatch.{}", match_id);
+
+  if (fallback) {
+    PrintCopyInstruction(out, hole, CopySuf(node->GetType()));
+  } else {
+    CallAbort(node);
+  }
+
+  Label("match_end.{}", match_id);
+
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -448,19 +1061,38 @@ void IrEmitter::VisitNew(NewExpression* node) {
   auto out = GenTemporary();
   auto type_size = GetTypeSize(node->underlying_);
 
-  auto size = GenTemporary();
-  fmt::print("  {} =w copy {}\n", size.Emit(), type_size);
+  // The count of an allocation on the stack is a literal
+  if (on_stack_.contains(node)) {
+    auto count = node->allocation_size_ ? Eval(node->allocation_size_).value
+                                        : 1;
+    auto align = measure_.MeasureAlignment(node->underlying_);
 
-  if (node->allocation_size_) {
-    auto alloc_size = Eval(node->allocation_size_);
-    fmt::print("  {} =w mul {}, {}\n",  //
-               size.Emit(), alloc_size.Emit(), type_size);
-  }
+    PrintAlloc(out, std::max<size_t>(align, 4), count * type_size);
+    allocations_on_stack_ += 1;
+  } else {
+    // In 64 bits, so that the product does not wrap around
+    auto size = GenTemporary();
+    Print("  {} =l copy {}\n", size, type_size);
+
+    if (auto n = node->allocation_size_) {
+      auto count = Eval(n);
+
+      if (ToQbeType(n->GetType()) == "w") {
+        auto wide = GenTemporary();
+        Print("  {} =l extsw {}\n", wide, count);
+        count = wide;
+      }
+
+      Print("  {} =l mul {}, {}\n",  //
+            size, count, type_size);
+    }
 
-  fmt::print("  {} =l call $malloc (w {})\n", out.Emit(), size.Emit());
+    Print("  {} =l call ${} (l {})\n",  //
+          out, pool_allocator_ ? "et_alloc" : "malloc", size);
+  }
 
   if (node->initial_value_) {
-    GenAtAddress(node->initial_value_, out);
+    GenAtAddress(node->initial_value_, out, true);
   }
 
   return_value = out;
@@ -491,9 +1123,9 @@ void IrEmitter::VisitCompoundInitalizer(CompoundInitializerExpr* node) {
   auto out = GenTemporary();
 
   auto [size, alignment] = SizeAlign(node);
-  fmt::print("  {} =l alloc{} {}\n", out.Emit(), alignment, size);
+  PrintAlloc(out, alignment, size);
 
-  GenAtAddress(node, out);
+  GenAtAddress(node, out, true);
   return_value = out;
 }
 
@@ -515,8 +1147,8 @@ void IrEmitter::VisitFieldAccess(FieldAccessExpression* node) {
   }
 
   auto out = GenTemporary();
-  fmt::print("  {} = {} load{} {}  \n", out.Emit(), ToQbeType(node->GetType()),
-             LoadSuf(node->GetType()), addr.Emit());
+  Print("  {} = {} load{} {}  \n", out, ToQbeType(node->GetType()),
+        LoadSuf(node->GetType()), addr);
   return_value = out;
 }
 
@@ -528,6 +1160,18 @@ void IrEmitter::VisitTypecast(TypecastExpression* node) {
   auto original = node->expr_->GetType();
   auto target = node->type_;
 
+  auto numeric = [](types::Type* ty) {
+    return IntegerBits(ty) || IsFloat(ty);
+  };
+
+  if (numeric(original) && numeric(target)) {
+    auto value = Eval(node->expr_);
+    return_value = IsFloat(original) || IsFloat(target)
+                       ? ConvertFloat(value, original, target)
+                       : ConvertInteger(value, original, target);
+    return;
+  }
+
   if (GetTypeSize(original) == GetTypeSize(target)) {
     return_value = Eval(node->expr_);
     return;
@@ -547,14 +1191,6 @@ void IrEmitter::VisitTypecast(TypecastExpression* node) {
     return;
   }
 
-  if (original->tag == types::TypeTag::TY_CHAR &&
-      target->tag == types::TypeTag::TY_INT) {
-    auto cast = GenTemporary();
-    fmt::print("  {} = w extub {}\n", cast.Emit(), Eval(node->expr_).Emit());
-    return_value = cast;
-    return;
-  }
-
   (void)node;
   std::abort();  // Unreachable
 }
@@ -565,7 +1201,13 @@ void IrEmitter::VisitLiteral(LiteralExpression* node) {
   switch (node->token_.type) {
     case lex::TokenType::CHAR:
     case lex::TokenType::NUMBER:
-      return_value = GenConstInt(std::get<int>(node->token_.sem_info));
+      return_value = GenConstInt(std::get<int64_t>(node->token_.sem_info));
+      break;
+
+    case lex::TokenType::FLOAT:
+      return_value = GenTemporary();
+      Print("  {} =d copy d_{}\n", return_value,
+            std::get<double>(node->token_.sem_info));
       break;
 
     case lex::TokenType::TRUE:
@@ -580,15 +1222,14 @@ void IrEmitter::VisitLiteral(LiteralExpression* node) {
       // section ".data.strdata.0"
       // data $strdata.0 = { b "fowiejf" }
 
-      return_value =
-          Value{.tag = Value::GLOBAL,
-                .name = fmt::format("strdata.{}", string_literals_.size())};
-
       // section ".data.lit"
       // data $lit = { l $strdata.0, l 7, l 7 }
 
-      string_literals_.push_back(
-          std::get<std::string_view>(node->token_.sem_info));
+      return_value = Value{
+          .tag = Value::GLOBAL,
+          .name = fmt::format(
+              "strdata.{}",
+              InternString(std::get<std::string_view>(node->token_.sem_info)))};
       break;
 
     case lex::TokenType::UNIT:
@@ -631,13 +1272,19 @@ void IrEmitter::VisitVarAccess(VarAccessExpression* node) {
       return_value = location;
       return;
 
+    // Read now, the variable may be assigned before the value is used
+    case Value::LOCAL:
+      Print("  {} ={} copy {}\n",  //
+            out, ToQbeType(node->GetType()), location);
+      break;
+
       // But do need to load locals
     case Value::TEMPORARY: {
       auto eq_type = ToQbeType(node->GetType());
       auto load_suf = LoadSuf(node->GetType());
 
-      fmt::print("  {} = {} load{} {}\n",  //
-                 out.Emit(), eq_type, load_suf, location.Emit());
+      Print("  {} = {} load{} {}\n",  //
+            out, eq_type, load_suf, location);
       break;
     }
 
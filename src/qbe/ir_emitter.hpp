@@ -3,29 +3,41 @@
 #include <qbe/qbe_value.hpp>
 #include <qbe/qbe_types.hpp>
 #include <qbe/measure.hpp>
+#include <qbe/passes.hpp>
+#include <qbe/pool_allocator.hpp>
 
 #include <ast/visitors/template_visitor.hpp>
 
 #include <ast/declarations.hpp>
 #include <ast/patterns.hpp>
 
+#include <fmt/format.h>
+
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <deque>
+#include <span>
 
 namespace qbe {
 
 class GenMatch;
 class GenAddr;
 class GenAt;
+class TailCalls;
+class AddressTaken;
 
 class IrEmitter : public ReturnVisitor<Value> {
  public:
   friend class GenMatch;
+  friend class DecisionTree;
   friend class GenAddr;
   friend class GenAt;
+  friend class EscapeAnalysis;
 
   virtual void VisitAssignment(AssignmentStatement* node) override;
   virtual void VisitReturn(ReturnStatement* node) override;
+  virtual void VisitLoopControl(LoopControlStatement* node) override;
   virtual void VisitYield(YieldStatement* node) override;
   virtual void VisitExprStatement(ExprStatement* node) override;
 
@@ -43,6 +55,7 @@ class IrEmitter : public ReturnVisitor<Value> {
   virtual void VisitDeref(DereferenceExpression* node) override;
   virtual void VisitAddressof(AddressofExpression* node) override;
   virtual void VisitIf(IfExpression* node) override;
+  virtual void VisitWhile(WhileExpression* node) override;
   virtual void VisitMatch(MatchExpression* node) override;
   virtual void VisitNew(NewExpression* node) override;
   virtual void VisitBlock(BlockExpression* node) override;
@@ -80,6 +93,11 @@ class IrEmitter : public ReturnVisitor<Value> {
       return;
     }
 
+    // Members are emitted first, so a type may be reached more than once
+    if (!emitted_types_.insert(Mangle(*ty)).second) {
+      return;
+    }
+
     switch (storage->tag) {
       case types::TypeTag::TY_STRUCT: {
         auto& members = storage->as_struct.first;
@@ -88,13 +106,13 @@ class IrEmitter : public ReturnVisitor<Value> {
           EmitType(mem.ty);
         }
 
-        fmt::print("type :{} = {{ ", Mangle(*ty));
+        Print("type {} = {{ ", AggregateName(ty));
 
         for (auto& mem : members) {
-          fmt::print("{} {}, ", ToQbeType(mem.ty), 1);
+          Print("{} {}, ", MemberType(mem.ty), 1);
         }
 
-        fmt::print("}}\n");
+        Print("}}\n");
         break;
       }
 
@@ -105,12 +123,12 @@ class IrEmitter : public ReturnVisitor<Value> {
           EmitType(mem.ty);
         }
 
-        fmt::print("type :{} = {{ w 1, ", Mangle(*ty));
+        Print("type {} = {{ w 1, ", AggregateName(ty));
 
         auto size = measure_.MeasureSum(storage);
-        fmt::print(" w {} ", size / 4 - 1);
+        Print(" w {} ", size / 4 - 1);
 
-        fmt::print("}}\n");
+        Print("}}\n");
         break;
       }
 
@@ -125,30 +143,215 @@ class IrEmitter : public ReturnVisitor<Value> {
     }
   }
 
+  IrEmitter() {
+    passes_.Add("threaded jumps", ir::ThreadJumps);
+    passes_.Add("unreachable blocks removed", ir::RemoveUnreachableBlocks);
+  }
+
   ~IrEmitter() {
     EmitTestArray();
     EmitStringLiterals();
+    EmitMatchTables();
+    EmitPoolAllocator();
+    WriteOut();
+  }
+
+  // Emits the instances, merging groups of functions that tail call each
+  // other into one QBE function
+  void EmitFunctions(const std::vector<FunDeclStatement*>& funs);
+
+  const std::vector<std::vector<std::string>>& TailGroups() const {
+    return tail_groups_;
+  }
+
+  size_t LocalsInTemporaries() const {
+    return locals_in_temporaries_;
   }
 
+  size_t AllocationsOnStack() const {
+    return allocations_on_stack_;
+  }
+
+  const auto& PassStats() const {
+    return passes_.Stats();
+  }
+
+  // How the matches on constants were dispatched
+  struct MatchStats {
+    size_t lookup_tables = 0;
+    size_t binary_searches = 0;
+    size_t dense_switches = 0;
+    size_t compare_chains = 0;
+  };
+
+  const MatchStats& GetMatchStats() const {
+    return match_stats_;
+  }
+
+  // Folds instances whose bodies are identical once sizes and alignments
+  // match, keeping the first one and redirecting references to it.
+  // Returns the number of bodies dropped.
+  size_t ShareByLayout();
+
   void EmitStringLiterals() {
     for (size_t i = 0; i < string_literals_.size(); i++) {
-      fmt::print("data $strdata.{} = {{ b \"{}\", b 0 }}", i,
-                 string_literals_[i]);
-      fmt::print("\n");
+      Print("data $strdata.{} = {{ b \"{}\", b 0 }}", i, string_literals_[i]);
+      Print("\n");
+    }
+  }
+
+  // Routes `new` and `delete` to the allocator in pool_allocator.hpp
+  void SetPoolAllocator() {
+    pool_allocator_ = true;
+  }
+
+  void EmitPoolAllocator() {
+    if (pool_allocator_) {
+      Print("{}\n", kPoolAllocator);
+    }
+  }
+
+  void EmitMatchTables() {
+    for (size_t i = 0; i < match_tables_.size(); i++) {
+      Print("data $match_table.{} = {{ w {} }}\n", i,
+            fmt::join(match_tables_[i], " "));
     }
   }
 
   void EmitTestArray() {
-    fmt::print("export data $et_test_array = {{ ");
+    Print("export data $et_test_array = {{ ");
 
     for (size_t i = 0; i < test_functions_.size(); i++) {
-      fmt::print("l ${}, ", test_functions_[i]);
+      Print("l ${}, ", test_functions_[i]);
     }
 
-    fmt::print("l 0 }}\n");
+    Print("l 0 }}\n");
   }
 
  private:
+  template <typename... Args>
+  void Print(fmt::format_string<Args...> format, Args&&... args) {
+    fmt::format_to(std::back_inserter(buffer_), format,
+                   std::forward<Args>(args)...);
+  }
+
+  // A function is built block by block: what is printed after its header
+  // goes into the current block, up to the next label or jump
+
+  void OpenBody();
+
+  template <typename... Args>
+  void Label(fmt::format_string<Args...> format, Args&&... args) {
+    CloseCode();
+    function_.blocks.push_back(ir::Block{
+        .label = fmt::format(format, std::forward<Args>(args)...),
+        .code = {},
+        .jump = {},
+    });
+  }
+
+  template <typename... Args>
+  void Jump(fmt::format_string<Args...> format, Args&&... args) {
+    EndBlock(ir::Jump{
+        .op = "jmp",
+        .operand = {},
+        .targets = {fmt::format(format, std::forward<Args>(args)...)},
+    });
+  }
+
+  void Branch(Value condition, std::string yes, std::string no) {
+    EndBlock(ir::Jump{
+        .op = "jnz",
+        .operand = condition.Emit(),
+        .targets = {std::move(yes), std::move(no)},
+    });
+  }
+
+  void Return(Value value) {
+    EndBlock(ir::Jump{.op = "ret", .operand = value.Emit(), .targets = {}});
+  }
+
+  void EndBlock(ir::Jump jump);
+  void CloseCode();
+
+  // Ends the current piece of output, `name` is set for functions, which
+  // go through the passes first
+  void Commit(std::string name = {}, std::string layout = {});
+
+  void PrintCopyInstruction(Value out, Value res, std::string_view assign);
+
+  void KeepExtended(Value value, types::Type* type);
+  Value ConvertInteger(Value value, types::Type* from, types::Type* to);
+  Value ConvertFloat(Value value, types::Type* from, types::Type* to);
+
+  void PrintAlloc(Value out, size_t align, size_t size) {
+    fmt::format_to(std::back_inserter(allocs_), "  {} =l alloc{} {}\n",
+                   out, align, size);
+  }
+
+  struct Arg {
+    Value v;
+    std::string_view qbe_ty;
+  };
+
+  // Where a tail call to a function may jump instead
+  struct Entry {
+    std::vector<Value> params;
+    std::string label;
+    bool used = false;
+  };
+
+  std::string FunctionName(FunDeclStatement* node);
+
+  std::string CalleeName(FnCallExpression* node);
+
+  std::vector<Value> PrintHeader(FunDeclStatement* node, std::string_view name);
+
+  void RegisterTest(FunDeclStatement* node);
+
+  bool InTemporary(VarDeclStatement* node);
+
+  bool IsTailJump(FnCallExpression* node, std::string_view mangled);
+
+  void JumpToEntry(FnCallExpression* node, std::span<Arg> args, Entry& target);
+
+  // Whether C may call the function or define it, by the same name
+  bool HasCName(FunDeclStatement* node);
+  bool HasCName(FnCallExpression* node);
+
+  // Compound results are returned through a slot the caller passes as the
+  // first argument, so they can be built right where they are needed.
+  // Functions with C names keep QBE's aggregate return, which is C's.
+  bool ReturnsInSlot(types::Type* result, bool c_name) {
+    return !c_name && measure_.IsCompound(result) && !measure_.IsZST(result);
+  }
+
+  // `slot` receives a compound result
+  Value EmitCall(FnCallExpression* node, Value slot);
+
+  void PrintReturn(Expression* value);
+
+  // With a `dest`, every arm builds the compound value there
+  Value EmitIf(IfExpression* node, Value dest, bool fresh);
+  Value EmitMatch(MatchExpression* node, Value dest, bool fresh);
+
+  // Reads the result of a match from a table, if it maps dense constants
+  // to constants
+  bool EmitMatchTable(MatchExpression* node, Value target, Value out,
+                      int match_id);
+
+  void SpliceEntry(std::string_view label);
+
+  void EmitGroup(const std::vector<FunDeclStatement*>& members);
+
+  void EmitGroupMember(FunDeclStatement* node, size_t selector,
+                       const std::vector<FunDeclStatement*>& members,
+                       std::string_view group);
+
+  std::string LayoutSignature(types::Type* fn_type);
+
+  void WriteOut();
+
   char GetStoreSuf(size_t align) {
     switch (align) {
       case 1:
@@ -187,30 +390,12 @@ class IrEmitter : public ReturnVisitor<Value> {
     }
   }
 
-  void Copy(size_t align, size_t size, Value src, Value dst) {
-    auto str_suf = GetStoreSuf(align);
-    auto ld_suf = GetLoadSuf(align);
-    auto ld_res = LoadResult(align);
-
-    auto temp = GenTemporary();
-    auto src_ptr = GenTemporary();
-    auto dst_ptr = GenTemporary();
-
-    fmt::print("  {} = l copy {}\n", src_ptr.Emit(), src.Emit());
-    fmt::print("  {} = l copy {}\n", dst_ptr.Emit(), dst.Emit());
+  // Copies `size` bytes between the addresses
+  void Copy(size_t size, Value src, Value dst);
 
-    for (size_t copied = 0; copied < size; copied += align) {
-      fmt::print("# Copying \n");
-      fmt::print("  {} = {} load{} {}\n", temp.Emit(), ld_res, ld_suf,
-                 src_ptr.Emit());
-      fmt::print("  store{} {}, {}  \n", str_suf, temp.Emit(), dst_ptr.Emit());
-
-      fmt::print("  {} =l add {}, {}\n", src_ptr.Emit(), src_ptr.Emit(), align);
-      fmt::print("  {} =l add {}, {}\n", dst_ptr.Emit(), dst_ptr.Emit(), align);
-    }
-  }
+  void CopyMove(size_t width, Value src_ptr, Value dst_ptr);
 
-  uint8_t GetTypeSize(types::Type* t) {
+  size_t GetTypeSize(types::Type* t) {
     return measure_.MeasureSize(t);
   }
 
@@ -219,19 +404,30 @@ class IrEmitter : public ReturnVisitor<Value> {
 
     std::deque<Value> values;
 
+    // Variadic floats are passed as doubles
+    auto promote = [](types::Type* type) {
+      return type->tag == types::TypeTag::TY_F32 ? &types::builtin_f64 : type;
+    };
+
     for (auto& a : std::span(node->arguments_).subspan(1)) {
-      values.push_back(Eval(a));
+      auto value = Eval(a);
+
+      if (auto type = a->GetType(); promote(type) != type) {
+        value = ConvertFloat(value, type, promote(type));
+      }
+
+      values.push_back(value);
     }
 
-    fmt::print("  call $printf (l {}, ..., ", fmt.Emit());
+    Print("  call $printf (l {}, ..., ", fmt);
 
     for (auto& a : std::span(node->arguments_).subspan(1)) {
       auto value = std::move(values.front());
-      fmt::print("{} {}, ", ToQbeType(a->GetType()), value.Emit());
+      Print("{} {}, ", ToQbeType(promote(a->GetType())), value);
       values.pop_front();
     }
 
-    fmt::print(")\n");
+    Print(")\n");
   }
 
   void CheckAssertion(Expression* cond) {
@@ -241,29 +437,38 @@ class IrEmitter : public ReturnVisitor<Value> {
 
     auto condition = Eval(cond);
 
-    fmt::print("#if-start\n");
-    fmt::print("  jnz {}, @true.{}, @false.{}\n", condition.Emit(), true_id,
-               false_id);
+    Branch(condition, fmt::format("true.{}", true_id),
+           fmt::format("false.{}", false_id));
 
-    fmt::print("@true.{}          \n", true_id);
+    Label("true.{}", true_id);
     // Do nothing
-    fmt::print("  jmp @join.{}    \n", join_id);
+    Jump("join.{}", join_id);
 
-    fmt::print("@false.{}         \n", false_id);
+    Label("false.{}", false_id);
     CallAbort(cond);
 
-    fmt::print("@join.{}          \n", join_id);
+    Label("join.{}", join_id);
   }
 
   void CallAbort(Expression* cond) {
     error_msg_storage_.push_back(
         fmt::format("Abort at {}\\n", cond->GetLocation().Format()));
 
-    string_literals_.push_back(error_msg_storage_.back());
+    Print("  call $printf (l $strdata.{}, ..., ) \n",
+          InternString(error_msg_storage_.back()));
+    Print("  call $abort ()  \n");
+  }
 
-    fmt::print("  call $printf (l $strdata.{}, ..., ) \n",
-               string_literals_.size() - 1);
-    fmt::print("  call $abort ()  \n");
+  // Equal literals share the data, which also keeps equal bodies equal
+  size_t InternString(std::string_view literal) {
+    auto [it, inserted] =
+        literal_ids_.try_emplace(literal, string_literals_.size());
+
+    if (inserted) {
+      string_literals_.push_back(literal);
+    }
+
+    return it->second;
   }
 
   Value GenParam() {
@@ -274,7 +479,11 @@ class IrEmitter : public ReturnVisitor<Value> {
     return {.tag = Value::TEMPORARY, .id = id_ += 1};
   }
 
-  Value GenConstInt(int value) {
+  Value GenLocal() {
+    return {.tag = Value::LOCAL, .id = id_ += 1};
+  }
+
+  Value GenConstInt(int64_t value) {
     return {.tag = Value::CONST_INT, .value = value};
   }
 
@@ -284,17 +493,57 @@ class IrEmitter : public ReturnVisitor<Value> {
 
   void GenAddress(Expression* what, Value out);
 
-  void GenAtAddress(Expression* what, Value where);
+  // `fresh` if nothing can observe `where` before the value is there, so
+  // a callee may build its result in place
+  void GenAtAddress(Expression* what, Value where, bool fresh = false);
 
  private:
   int id_ = 0;
 
   std::unordered_map<std::string_view, Value> named_values_;
 
+  // The function being emitted, and all functions sharing its QBE body
+  std::string function_name_;
+  std::unordered_map<std::string, Entry> entries_;
+  TailCalls* tail_calls_ = nullptr;
+  AddressTaken* address_taken_ = nullptr;
+  Value result_slot_ = Value::None();
+  size_t locals_in_temporaries_ = 0;
+
+  // `new` expressions whose object does not outlive the function
+  std::unordered_set<NewExpression*> on_stack_;
+  size_t allocations_on_stack_ = 0;
+  MatchStats match_stats_;
+  bool pool_allocator_ = false;
+
+  // Label ids of the enclosing loops, innermost last
+  std::vector<int> loops_;
+
+  std::vector<std::vector<std::string>> tail_groups_;
+
   std::vector<std::string_view> string_literals_;
+  std::unordered_map<std::string_view, size_t> literal_ids_;
   std::vector<std::string_view> test_functions_;
-
-  std::vector<std::string> error_msg_storage_;
+  std::vector<std::vector<int>> match_tables_;
+
+  std::deque<std::string> error_msg_storage_;
+
+  // Output is kept until the end, so that functions can be folded
+  struct Chunk {
+    std::string text;
+    std::string name;
+    std::string layout;  // Empty if the function can not be shared
+    bool dropped = false;
+  };
+
+  fmt::memory_buffer buffer_;
+  fmt::memory_buffer allocs_;
+  ir::Function function_;
+  std::vector<Chunk> chunks_;
+  ir::PassManager passes_;
+  std::unordered_map<std::string, std::string> renamed_;
+
+  std::unordered_set<std::string_view> emitted_types_;
 
   detail::SizeMeasure measure_;
 };
@@ -0,0 +1,195 @@
+#include <qbe/ir_emitter.hpp>
+
+#include <cstdio>
+#include <map>
+
+namespace qbe {
+
+////////////////////////////////////////////////////////////////////
+
+// Sizes, alignments and QBE classes of the arguments and the result
+
+std::string IrEmitter::LayoutSignature(types::Type* fn_type) {
+  std::string signature;
+
+  auto add = [&](types::Type* ty) {
+    auto cls = measure_.IsCompound(ty) ? std::string_view{"m"}
+                                       : ToQbeType(types::TypeStorage(ty));
+    fmt::format_to(std::back_inserter(signature), "{}{}.{},", cls,
+                   measure_.MeasureSize(ty), measure_.MeasureAlignment(ty));
+  };
+
+  for (auto param : fn_type->as_fun.param_pack) {
+    add(param);
+  }
+
+  add(fn_type->as_fun.result_type);
+
+  return signature;
+}
+
+////////////////////////////////////////////////////////////////////
+
+// Positions of the names following `$`
+
+static std::vector<std::pair<size_t, size_t>> GlobalNames(
+    std::string_view text) {
+  std::vector<std::pair<size_t, size_t>> names;
+
+  auto is_name = [](char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+  };
+
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] != '$') {
+      continue;
+    }
+
+    auto start = i + 1;
+    auto end = start;
+
+    while (end < text.size() && is_name(text[end])) {
+      end += 1;
+    }
+
+    names.emplace_back(start, end - start);
+    i = end - 1;
+  }
+
+  return names;
+}
+
+////////////////////////////////////////////////////////////////////
+
+// Optimistic partition refinement: start from classes of bodies that are
+// equal up to the functions they refer to, then split a class whenever
+// its members refer to functions from different classes. What remains
+// can be folded, recursion included.
+
+size_t IrEmitter::ShareByLayout() {
+  Commit();
+
+  std::unordered_map<std::string_view, size_t> functions;
+  std::vector<size_t> order;
+
+  for (size_t i = 0; i < chunks_.size(); i++) {
+    if (!chunks_[i].name.empty()) {
+      functions.emplace(chunks_[i].name, i);
+      order.push_back(i);
+    }
+  }
+
+  std::vector<std::vector<size_t>> refs(chunks_.size());
+  std::vector<size_t> classes(chunks_.size());
+
+  {
+    std::unordered_map<std::string, size_t> initial;
+
+    for (auto i : order) {
+      std::string_view text = chunks_[i].text;
+
+      auto key = chunks_[i].layout.empty() ? fmt::format("!{}", i)
+                                           : chunks_[i].layout + '\n';
+      size_t last = 0;
+
+      for (auto [start, len] : GlobalNames(text)) {
+        auto it = functions.find(text.substr(start, len));
+
+        if (it == functions.end()) {
+          continue;
+        }
+
+        key.append(text.substr(last, start - last));
+        key += '\0';
+        last = start + len;
+
+        refs[i].push_back(it->second);
+      }
+
+      key.append(text.substr(last));
+      classes[i] = initial.try_emplace(std::move(key), initial.size())
+                       .first->second;
+    }
+  }
+
+  for (size_t count = 0;;) {
+    std::map<std::vector<size_t>, size_t> refined;
+    std::vector<size_t> next(chunks_.size());
+
+    for (auto i : order) {
+      std::vector<size_t> key{classes[i]};
+
+      for (auto r : refs[i]) {
+        key.push_back(classes[r]);
+      }
+
+      next[i] = refined.try_emplace(std::move(key), refined.size())
+                    .first->second;
+    }
+
+    std::swap(classes, next);
+
+    if (refined.size() == count) {
+      break;
+    }
+
+    count = refined.size();
+  }
+
+  // The first instance of a class is kept, the rest refer to it
+
+  std::unordered_map<size_t, size_t> representative;
+  size_t dropped = 0;
+
+  for (auto i : order) {
+    auto [it, first] = representative.try_emplace(classes[i], i);
+
+    if (!first) {
+      chunks_[i].dropped = true;
+      renamed_.emplace(chunks_[i].name, chunks_[it->second].name);
+      dropped += 1;
+    }
+  }
+
+  return dropped;
+}
+
+////////////////////////////////////////////////////////////////////
+
+// The whole module goes out with a single write
+
+void IrEmitter::WriteOut() {
+  Commit();
+
+  fmt::memory_buffer out;
+  auto it = std::back_inserter(out);
+
+  for (auto& chunk : chunks_) {
+    if (chunk.dropped) {
+      continue;
+    }
+
+    std::string_view text = chunk.text;
+    size_t last = 0;
+
+    for (auto [start, len] : GlobalNames(text)) {
+      auto found = renamed_.find(std::string{text.substr(start, len)});
+
+      if (found == renamed_.end()) {
+        continue;
+      }
+
+      fmt::format_to(it, "{}{}", text.substr(last, start - last),
+                     found->second);
+      last = start + len;
+    }
+
+    fmt::format_to(it, "{}", text.substr(last));
+  }
+
+  std::fwrite(out.data(), 1, out.size(), stdout);
+}
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe
@@ -21,8 +21,16 @@ class SizeMeasure {
 
     switch (t->tag) {
       case types::TypeTag::TY_INT:
+      case types::TypeTag::TY_U32:
+      case types::TypeTag::TY_F32:
         return 4;
 
+      case types::TypeTag::TY_I16:
+      case types::TypeTag::TY_U16:
+        return 2;
+
+      case types::TypeTag::TY_I8:
+      case types::TypeTag::TY_U8:
       case types::TypeTag::TY_BOOL:
       case types::TypeTag::TY_CHAR:
         return 1;  // Is this ok?
@@ -31,6 +39,9 @@ class SizeMeasure {
       case types::TypeTag::TY_UNIT:
         return 0;
 
+      case types::TypeTag::TY_INT64:
+      case types::TypeTag::TY_U64:
+      case types::TypeTag::TY_F64:
       case types::TypeTag::TY_PTR:
       case types::TypeTag::TY_FUN:
         return 8;
@@ -124,8 +135,16 @@ class SizeMeasure {
 
     switch (t->tag) {
       case types::TypeTag::TY_INT:
+      case types::TypeTag::TY_U32:
+      case types::TypeTag::TY_F32:
         return 4;
 
+      case types::TypeTag::TY_I16:
+      case types::TypeTag::TY_U16:
+        return 2;
+
+      case types::TypeTag::TY_I8:
+      case types::TypeTag::TY_U8:
       case types::TypeTag::TY_BOOL:
       case types::TypeTag::TY_CHAR:
         return 1;
@@ -134,6 +153,9 @@ class SizeMeasure {
       case types::TypeTag::TY_UNIT:
         return 0;
 
+      case types::TypeTag::TY_INT64:
+      case types::TypeTag::TY_U64:
+      case types::TypeTag::TY_F64:
       case types::TypeTag::TY_PTR:
       case types::TypeTag::TY_FUN:
         return 8;
@@ -0,0 +1,107 @@
+#include <qbe/passes.hpp>
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace qbe::ir {
+
+////////////////////////////////////////////////////////////////////
+
+size_t RemoveUnreachableBlocks(Function& fn) {
+  if (fn.blocks.empty()) {
+    return 0;
+  }
+
+  std::unordered_map<std::string_view, size_t> index;
+
+  for (size_t b = 0; b < fn.blocks.size(); b++) {
+    index.emplace(fn.blocks[b].label, b);
+  }
+
+  std::vector<bool> reachable(fn.blocks.size());
+  std::vector<size_t> work{0};
+
+  while (!work.empty()) {
+    auto b = work.back();
+    work.pop_back();
+
+    if (reachable[b]) {
+      continue;
+    }
+
+    reachable[b] = true;
+
+    if (auto& jump = fn.blocks[b].jump) {
+      for (auto& target : jump->targets) {
+        work.push_back(index.at(target));
+      }
+    } else if (b + 1 < fn.blocks.size()) {
+      work.push_back(b + 1);
+    }
+  }
+
+  // A reachable block that falls through keeps its successor, so the
+  // order of the survivors is still right
+
+  size_t b = 0;
+
+  return std::erase_if(fn.blocks, [&](const Block&) {
+    return !reachable[b++];
+  });
+}
+
+////////////////////////////////////////////////////////////////////
+
+size_t ThreadJumps(Function& fn) {
+  std::unordered_map<std::string, std::string> forward;
+
+  // The entry block is never a target
+  for (size_t b = 1; b < fn.blocks.size(); b++) {
+    auto& block = fn.blocks[b];
+
+    if (!block.code.empty()) {
+      continue;
+    }
+
+    if (!block.jump && b + 1 < fn.blocks.size()) {
+      forward.emplace(block.label, fn.blocks[b + 1].label);
+    } else if (block.jump && block.jump->op == "jmp") {
+      forward.emplace(block.label, block.jump->targets[0]);
+    }
+  }
+
+  auto resolve = [&](const std::string& label) {
+    std::unordered_set<std::string_view> seen;
+    auto* final = &label;
+
+    // An empty loop stays a loop
+    for (auto it = forward.find(*final);
+         it != forward.end() && seen.insert(*final).second;
+         it = forward.find(*final)) {
+      final = &it->second;
+    }
+
+    return *final;
+  };
+
+  size_t threaded = 0;
+
+  for (auto& block : fn.blocks) {
+    if (!block.jump) {
+      continue;
+    }
+
+    for (auto& target : block.jump->targets) {
+      if (auto final = resolve(target); final != target) {
+        target = std::move(final);
+        threaded += 1;
+      }
+    }
+  }
+
+  return threaded;
+}
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe::ir
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <qbe/ir.hpp>
+
+#include <utility>
+
+namespace qbe::ir {
+
+//////////////////////////////////////////////////////////////////////
+
+// A pass rewrites a function and returns how many changes it made
+
+using Pass = size_t (*)(Function& fn);
+
+// Drops the blocks no path from the entry reaches, such as the ones
+// opened after a `ret`
+size_t RemoveUnreachableBlocks(Function& fn);
+
+// Jumps to a block that only jumps on go straight to the final target
+size_t ThreadJumps(Function& fn);
+
+//////////////////////////////////////////////////////////////////////
+
+class PassManager {
+ public:
+  void Add(std::string_view name, Pass pass) {
+    passes_.emplace_back(name, pass);
+    stats_.emplace_back(name, 0);
+  }
+
+  void Run(Function& fn) {
+    for (size_t i = 0; i < passes_.size(); i++) {
+      stats_[i].second += passes_[i].second(fn);
+    }
+  }
+
+  // Changes made by every pass so far, in the order the passes run
+  const std::vector<std::pair<std::string_view, size_t>>& Stats() const {
+    return stats_;
+  }
+
+ private:
+  std::vector<std::pair<std::string_view, Pass>> passes_;
+  std::vector<std::pair<std::string_view, size_t>> stats_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe::ir
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string_view>
+
+namespace qbe {
+
+//////////////////////////////////////////////////////////////////////
+
+// The allocator behind `new` and `delete` with -a, emitted into the
+// program so that nothing else has to be linked in.
+//
+// Blocks up to 256 bytes are kept on free lists segregated by size in
+// steps of 16, and new ones are carved from 64 KiB chunks; larger ones
+// come from malloc. The word in front of every object holds its class,
+// or -1 for malloc, and a free block links to the next one right after.
+// Etude programs are single-threaded, so the lists need no locks.
+
+inline constexpr std::string_view kPoolAllocator = R"(
+data $et_pool_lists = { z 136 }
+data $et_pool_chunk = { l 0, l 0 }
+
+function l $et_alloc (l %size) {
+@start
+  %total =l add %size, 8
+  %large =w cugtl %total, 256
+  jnz %large, @large, @small
+@large
+  %block =l call $malloc (l %total)
+  storel -1, %block
+  %object =l add %block, 8
+  ret %object
+@small
+  %class =l add %total, 15
+  %class =l shr %class, 4
+  %offset =l mul %class, 8
+  %list =l add $et_pool_lists, %offset
+  %block =l loadl %list
+  jnz %block, @reuse, @carve
+@reuse
+  %link =l add %block, 8
+  %next =l loadl %link
+  storel %next, %list
+  ret %link
+@carve
+  %bytes =l shl %class, 4
+  %end_slot =l add $et_pool_chunk, 8
+  %block =l loadl $et_pool_chunk
+  %end =l loadl %end_slot
+  %after =l add %block, %bytes
+  %fits =w culel %after, %end
+  jnz %fits, @take, @refill
+@refill
+  %block =l call $malloc (l 65536)
+  %end =l add %block, 65536
+  storel %end, %end_slot
+  %after =l add %block, %bytes
+@take
+  storel %after, $et_pool_chunk
+  storel %class, %block
+  %object =l add %block, 8
+  ret %object
+}
+
+function $et_free (l %object) {
+@start
+  jnz %object, @some, @done
+@some
+  %block =l sub %object, 8
+  %class =l loadl %block
+  %large =w ceql %class, -1
+  jnz %large, @large, @small
+@large
+  call $free (l %block)
+  ret
+@small
+  %offset =l mul %class, 8
+  %list =l add $et_pool_lists, %offset
+  %next =l loadl %list
+  storel %next, %object
+  storel %block, %list
+@done
+  ret
+}
+)";
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe
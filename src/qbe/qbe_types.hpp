@@ -2,45 +2,122 @@
 
 #include <types/type.hpp>
 
+#include <functional>
+
 namespace qbe {
 
 ////////////////////////////////////////////////////////////////////
 
-inline std::string ToQbeType(types::Type* type) {
+// QBE reads identifiers into buffers of 80 characters. Longer names keep
+// their start and have the rest replaced by a hash of the whole name,
+// leaving room for suffixes such as `.tail`.
+inline std::string FitName(std::string name) {
+  constexpr size_t kMaxName = 64;
+
+  if (name.size() <= kMaxName) {
+    return name;
+  }
+
+  auto hash = std::hash<std::string_view>{}(name);
+  name.resize(kMaxName - 17);
+  return fmt::format("{}_{:016x}", name, hash);
+}
+
+////////////////////////////////////////////////////////////////////
+
+// Interned per mangled name, so the returned views stay valid. The name
+// must start with a letter, while a mangled name may start with a digit
+inline std::string_view AggregateName(types::Type* type) {
+  static std::unordered_map<std::string_view, std::string> names;
+
+  auto mangled = types::Mangle(*type);
+
+  if (auto it = names.find(mangled); it != names.end()) {
+    return it->second;
+  }
+
+  return names[mangled] = ":" + FitName(fmt::format("T{}", mangled));
+}
+
+inline std::string_view ToQbeType(types::Type* type) {
   switch (type->tag) {
     case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_I8:
+    case types::TypeTag::TY_I16:
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_U16:
+    case types::TypeTag::TY_U32:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_BOOL:
       return "w";
 
+    case types::TypeTag::TY_INT64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
     case types::TypeTag::TY_FUN:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     case types::TypeTag::TY_UNIT:
       return "";
 
     case types::TypeTag::TY_APP:
     case types::TypeTag::TY_STRUCT:
-      return ":" + types::Mangle(*type);
+      return AggregateName(type);
 
     default:
       std::abort();
   }
 }
 
+// Fields of aggregate types keep the width they are stored with
+inline std::string_view MemberType(types::Type* type) {
+  switch (type->tag) {
+    case types::TypeTag::TY_I8:
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_CHAR:
+    case types::TypeTag::TY_BOOL:
+      return "b";
+
+    case types::TypeTag::TY_I16:
+    case types::TypeTag::TY_U16:
+      return "h";
+
+    default:
+      return ToQbeType(type);
+  }
+}
+
 inline std::string_view CopySuf(types::Type* type) {
   switch (type->tag) {
     case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_I8:
+    case types::TypeTag::TY_I16:
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_U16:
+    case types::TypeTag::TY_U32:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_BOOL:
       return "w";
 
+    case types::TypeTag::TY_INT64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
     case types::TypeTag::TY_APP:
     case types::TypeTag::TY_STRUCT:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     case types::TypeTag::TY_UNIT:
     case types::TypeTag::TY_NEVER:
       return "";
@@ -50,19 +127,41 @@ inline std::string_view CopySuf(types::Type* type) {
   }
 }
 
+// Also names the extension of a value of the type, as in `ext{}`
 inline std::string_view LoadSuf(types::Type* ty) {
   switch (ty->tag) {
     case types::TypeTag::TY_INT:
       return "sw";
 
+    case types::TypeTag::TY_U32:
+      return "uw";
+
+    case types::TypeTag::TY_I16:
+      return "sh";
+
+    case types::TypeTag::TY_U16:
+      return "uh";
+
+    case types::TypeTag::TY_I8:
+      return "sb";
+
+    case types::TypeTag::TY_U8:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_UNIT:
     case types::TypeTag::TY_BOOL:
       return "ub";
 
+    case types::TypeTag::TY_INT64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     default:
       std::abort();
   }
@@ -71,21 +170,81 @@ inline std::string_view LoadSuf(types::Type* ty) {
 inline std::string_view StoreSuf(types::Type* ty) {
   switch (ty->tag) {
     case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_U32:
       return "w";
 
+    case types::TypeTag::TY_I16:
+    case types::TypeTag::TY_U16:
+      return "h";
+
+    case types::TypeTag::TY_I8:
+    case types::TypeTag::TY_U8:
     case types::TypeTag::TY_CHAR:
     case types::TypeTag::TY_UNIT:
     case types::TypeTag::TY_BOOL:
       return "b";
 
+    case types::TypeTag::TY_INT64:
+    case types::TypeTag::TY_U64:
     case types::TypeTag::TY_PTR:
       return "l";
 
+    case types::TypeTag::TY_F32:
+      return "s";
+
+    case types::TypeTag::TY_F64:
+      return "d";
+
     default:
       std::abort();
   }
 }
 
+// Width of an integer type in bits, 0 for other types
+inline size_t IntegerBits(types::Type* ty) {
+  switch (ty->tag) {
+    case types::TypeTag::TY_I8:
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_CHAR:
+      return 8;
+
+    case types::TypeTag::TY_I16:
+    case types::TypeTag::TY_U16:
+      return 16;
+
+    case types::TypeTag::TY_INT:
+    case types::TypeTag::TY_U32:
+      return 32;
+
+    case types::TypeTag::TY_INT64:
+    case types::TypeTag::TY_U64:
+      return 64;
+
+    default:
+      return 0;
+  }
+}
+
+inline bool IsFloat(types::Type* ty) {
+  return ty->tag == types::TypeTag::TY_F32 ||
+         ty->tag == types::TypeTag::TY_F64;
+}
+
+inline bool IsUnsigned(types::Type* ty) {
+  switch (ty->tag) {
+    case types::TypeTag::TY_U8:
+    case types::TypeTag::TY_U16:
+    case types::TypeTag::TY_U32:
+    case types::TypeTag::TY_U64:
+    case types::TypeTag::TY_CHAR:
+    case types::TypeTag::TY_BOOL:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 
 }  // namespace qbe
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <fmt/core.h>
+#include <cstdint>
 #include <string>
 
 namespace qbe {
@@ -11,6 +12,7 @@ struct Value {
     PARAM,
     GLOBAL,
     TEMPORARY,
+    LOCAL,  // A variable kept in a temporary rather than in memory
     CONST_INT,
   } tag;
 
@@ -24,27 +26,46 @@ struct Value {
     return res;
   }
 
-  std::string Emit() const {
-    switch (tag) {
-      case NONE:
-        return "";
-      case GLOBAL:
-        return fmt::format("${}", name);
-      case TEMPORARY:
-      case PARAM:
-        return fmt::format("%.{}", id);
-      case CONST_INT:
-        return fmt::format("{}", value);
-      default:
-        std::abort();
-    }
-  }
+  std::string Emit() const;
 
   std::string_view aggregate_type{};
   std::string name{};
   size_t addr = 0;
-  int value = 0;
+  int64_t value = 0;
   int id = 0;
 };
 
 }  // namespace qbe
+
+//////////////////////////////////////////////////////////////////////
+
+// Values are formatted straight into the output, without a temporary string
+
+template <>
+struct fmt::formatter<qbe::Value> {
+  constexpr auto parse(format_parse_context& ctx) {
+    return ctx.begin();
+  }
+
+  template <typename FormatContext>
+  auto format(const qbe::Value& v, FormatContext& ctx) const {
+    switch (v.tag) {
+      case qbe::Value::NONE:
+        return ctx.out();
+      case qbe::Value::GLOBAL:
+        return fmt::format_to(ctx.out(), "${}", v.name);
+      case qbe::Value::TEMPORARY:
+      case qbe::Value::LOCAL:
+      case qbe::Value::PARAM:
+        return fmt::format_to(ctx.out(), "%.{}", v.id);
+      case qbe::Value::CONST_INT:
+        return fmt::format_to(ctx.out(), "{}", v.value);
+      default:
+        std::abort();
+    }
+  }
+};
+
+inline std::string qbe::Value::Emit() const {
+  return fmt::format("{}", *this);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <qbe/measure.hpp>
+
+#include <ast/visitors/just_walk_visitor.hpp>
+
+#include <unordered_set>
+#include <vector>
+
+namespace qbe {
+
+////////////////////////////////////////////////////////////////////
+
+// Finds the calls in tail position of a function body, and whether the
+// body hands out addresses into its own frame. Only then a tail call may
+// reuse the frame by jumping back to the entry.
+
+class TailCalls : public JustWalk {
+ public:
+  TailCalls(FunDeclStatement* fun, detail::SizeMeasure& measure)
+      : measure_{measure} {
+    MarkTail(fun->body_);
+    fun->body_->Accept(this);
+  }
+
+  bool IsTailCall(FnCallExpression* call) const {
+    return tail_calls_.contains(call);
+  }
+
+  // In order of appearance
+  const std::vector<FnCallExpression*>& Calls() const {
+    return calls_;
+  }
+
+  bool FrameEscapes() const {
+    return frame_escapes_;
+  }
+
+  void VisitReturn(ReturnStatement* node) override {
+    MarkTail(node->return_value_);
+    JustWalk::VisitReturn(node);
+  }
+
+  void VisitAddressof(AddressofExpression* node) override {
+    frame_escapes_ |= InFrame(node->operand_);
+    JustWalk::VisitAddressof(node);
+  }
+
+  // Reinterpreting an aggregate yields its address
+  void VisitTypecast(TypecastExpression* node) override {
+    frame_escapes_ |= measure_.IsCompound(node->expr_->GetType());
+    JustWalk::VisitTypecast(node);
+  }
+
+ private:
+  void MarkTail(Expression* expr) {
+    // Intrinsics are not calls
+    if (expr->as<IntrinsicCall>()) {
+      return;
+    }
+
+    if (auto call = expr->as<FnCallExpression>()) {
+      if (tail_calls_.insert(call).second) {
+        calls_.push_back(call);
+      }
+      return;
+    }
+
+    if (auto branch = expr->as<IfExpression>()) {
+      MarkTail(branch->true_branch_);
+      MarkTail(branch->false_branch_);
+      return;
+    }
+
+    if (auto block = expr->as<BlockExpression>()) {
+      if (block->final_) {
+        MarkTail(block->final_);
+      }
+      return;
+    }
+
+    if (auto match = expr->as<MatchExpression>()) {
+      for (auto& [pat, arm] : match->patterns_) {
+        MarkTail(arm);
+      }
+    }
+  }
+
+  // Anything but memory reached through a pointer may live in the frame
+  static bool InFrame(Expression* place) {
+    if (place->as<DereferenceExpression>()) {
+      return false;
+    }
+
+    if (auto access = place->as<FieldAccessExpression>()) {
+      return InFrame(access->struct_expression_);
+    }
+
+    return true;
+  }
+
+ private:
+  detail::SizeMeasure& measure_;
+
+  std::unordered_set<FnCallExpression*> tail_calls_;
+  std::vector<FnCallExpression*> calls_;
+  bool frame_escapes_ = false;
+};
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe
@@ -0,0 +1,338 @@
+#include <qbe/ir_emitter.hpp>
+#include <qbe/tail_calls.hpp>
+#include <qbe/address_taken.hpp>
+#include <qbe/escape_analysis.hpp>
+
+#include <algorithm>
+
+namespace qbe {
+
+////////////////////////////////////////////////////////////////////
+
+// Strongly connected components of the tail-call graph (Tarjan)
+
+class TailGraph {
+ public:
+  explicit TailGraph(std::vector<std::vector<size_t>> edges)
+      : edges_{std::move(edges)}, nodes_(edges_.size()) {
+  }
+
+  std::vector<std::vector<size_t>> Components() {
+    for (size_t v = 0; v < edges_.size(); v++) {
+      if (!nodes_[v].visited) {
+        StrongConnect(v);
+      }
+    }
+
+    return std::move(components_);
+  }
+
+ private:
+  void StrongConnect(size_t v) {
+    auto& node = nodes_[v];
+
+    node.visited = true;
+    node.index = node.lowlink = index_++;
+    node.on_stack = true;
+    stack_.push_back(v);
+
+    for (auto w : edges_[v]) {
+      if (!nodes_[w].visited) {
+        StrongConnect(w);
+        node.lowlink = std::min(node.lowlink, nodes_[w].lowlink);
+      } else if (nodes_[w].on_stack) {
+        node.lowlink = std::min(node.lowlink, nodes_[w].index);
+      }
+    }
+
+    if (node.lowlink != node.index) {
+      return;
+    }
+
+    std::vector<size_t> component;
+    size_t member;
+
+    do {
+      member = stack_.back();
+      stack_.pop_back();
+      nodes_[member].on_stack = false;
+      component.push_back(member);
+    } while (member != v);
+
+    std::sort(component.begin(), component.end());
+    components_.push_back(std::move(component));
+  }
+
+ private:
+  struct Node {
+    size_t index = 0;
+    size_t lowlink = 0;
+    bool visited = false;
+    bool on_stack = false;
+  };
+
+  std::vector<std::vector<size_t>> edges_;
+  std::vector<Node> nodes_;
+
+  size_t index_ = 0;
+  std::vector<size_t> stack_;
+  std::vector<std::vector<size_t>> components_;
+};
+
+////////////////////////////////////////////////////////////////////
+
+// Functions that tail call each other (after monomorphization, so every
+// edge is between instances) are emitted into one QBE function, where
+// those calls are jumps.
+
+void IrEmitter::EmitFunctions(const std::vector<FunDeclStatement*>& funs) {
+  std::unordered_map<std::string, size_t> index;
+  std::vector<bool> escapes(funs.size());
+
+  for (size_t i = 0; i < funs.size(); i++) {
+    if (funs[i]->body_) {
+      index.emplace(FunctionName(funs[i]), i);
+    }
+  }
+
+  std::vector<std::vector<size_t>> edges(funs.size());
+
+  for (size_t i = 0; i < funs.size(); i++) {
+    if (!funs[i]->body_) {
+      continue;
+    }
+
+    TailCalls tail_calls{funs[i], measure_};
+    escapes[i] = tail_calls.FrameEscapes();
+
+    for (auto call : tail_calls.Calls()) {
+      if (auto it = index.find(CalleeName(call)); it != index.end()) {
+        edges[i].push_back(it->second);
+      }
+    }
+  }
+
+  // A frame that escapes can't be entered by a jump, nor left by one
+
+  for (size_t i = 0; i < funs.size(); i++) {
+    std::erase_if(edges[i], [&](size_t j) {
+      return escapes[i] || escapes[j];
+    });
+  }
+
+  std::vector<bool> loops(funs.size());
+
+  for (size_t i = 0; i < funs.size(); i++) {
+    loops[i] = std::find(edges[i].begin(), edges[i].end(), i) != edges[i].end();
+  }
+
+  std::vector<std::vector<FunDeclStatement*>> groups;
+  std::vector<size_t> group_of(funs.size(), SIZE_MAX);
+
+  for (auto& component : TailGraph{std::move(edges)}.Components()) {
+    if (component.size() < 2) {
+      continue;
+    }
+
+    auto result = funs[component.front()]->type_->as_fun.result_type;
+
+    // Tail calls return what the callee returns, so this holds in practice
+    if (std::any_of(component.begin(), component.end(), [&](size_t i) {
+          auto other = funs[i]->type_->as_fun.result_type;
+          return ToQbeType(other) != ToQbeType(result);
+        })) {
+      continue;
+    }
+
+    std::vector<FunDeclStatement*> members;
+
+    for (auto i : component) {
+      members.push_back(funs[i]);
+      group_of[i] = groups.size();
+    }
+
+    groups.push_back(std::move(members));
+  }
+
+  // A jump back to an entry reuses the frame while the objects of the
+  // last pass may still be reachable, so those functions keep the heap
+
+  EscapeAnalysis escape{*this, funs};
+
+  for (size_t i = 0; i < funs.size(); i++) {
+    if (funs[i]->body_ && !loops[i] && group_of[i] == SIZE_MAX) {
+      for (auto node : escape.NonEscaping(funs[i])) {
+        on_stack_.insert(node);
+      }
+    }
+  }
+
+  // Every group is emitted at the position of its first member
+
+  for (size_t i = 0; i < funs.size(); i++) {
+    if (group_of[i] == SIZE_MAX) {
+      funs[i]->Accept(this);
+    } else if (groups[group_of[i]].front() == funs[i]) {
+      EmitGroup(groups[group_of[i]]);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////
+
+// function $f.tail (w %selector, <parameters of every member>) {
+// @start
+//   <dispatch on the selector>
+// @entry.0
+//   <body of the first member>
+// @entry.1
+//   ...
+// }
+
+void IrEmitter::EmitGroup(const std::vector<FunDeclStatement*>& members) {
+  Commit();
+  id_ = 0;
+  entries_.clear();
+
+  auto group = fmt::format("{}.tail", FunctionName(members.front()));
+  auto result = members.front()->type_->as_fun.result_type;
+
+  auto selector = GenParam();
+
+  // Every member builds a compound result in the same slot
+  if (ReturnsInSlot(result, false)) {
+    result_slot_ = GenParam();
+    Print("function ${} (w {}, l {}, ", group, selector, result_slot_);
+  } else {
+    result_slot_ = Value::None();
+    Print("function {} ${} (w {}, ", ToQbeType(result), group, selector);
+  }
+
+  for (size_t k = 0; k < members.size(); k++) {
+    auto& entry = entries_[FunctionName(members[k])];
+    entry.label = fmt::format("entry.{}", k);
+
+    for (auto ty : members[k]->type_->as_fun.param_pack) {
+      auto t = GenParam();
+      entry.params.push_back(t);
+
+      if (measure_.IsZST(ty)) {
+        continue;
+      }
+
+      // Aggregates stay with the member's caller, only the address is passed
+      auto cls = measure_.IsCompound(ty) ? std::string_view{"l"}
+                                         : ToQbeType(ty);
+      Print("{} {}, ", cls, t);
+    }
+  }
+
+  Print(") {{");
+  OpenBody();
+
+  for (size_t k = 0; k + 1 < members.size(); k++) {
+    auto is = GenTemporary();
+    Print("  {} =w ceqw {}, {}\n", is, selector, k);
+    Branch(is, fmt::format("entry.{}", k), fmt::format("dispatch.{}", k));
+    Label("dispatch.{}", k);
+  }
+
+  Jump("entry.{}", members.size() - 1);
+
+  for (auto member : members) {
+    function_name_ = FunctionName(member);
+
+    TailCalls tail_calls{member, measure_};
+    tail_calls_ = &tail_calls;
+
+    AddressTaken address_taken{member};
+    address_taken_ = &address_taken;
+
+    auto& entry = entries_.at(function_name_);
+
+    for (size_t i = 0; i < member->formals_.size(); i++) {
+      named_values_.insert_or_assign(member->formals_[i].GetName(),
+                                     entry.params[i]);
+    }
+
+    Label("{}", entry.label);
+    PrintReturn(member->body_);
+  }
+
+  SpliceEntry("");
+  tail_calls_ = nullptr;
+  address_taken_ = nullptr;
+
+  Commit(group);
+
+  std::vector<std::string> names;
+
+  for (size_t k = 0; k < members.size(); k++) {
+    EmitGroupMember(members[k], k, members, group);
+    names.push_back(FunctionName(members[k]));
+  }
+
+  tail_groups_.push_back(std::move(names));
+}
+
+////////////////////////////////////////////////////////////////////
+
+// The members keep their names and signatures and enter the group
+
+void IrEmitter::EmitGroupMember(FunDeclStatement* node, size_t selector,
+                                const std::vector<FunDeclStatement*>& members,
+                                std::string_view group) {
+  id_ = 0;
+
+  auto name = FunctionName(node);
+  auto params = PrintHeader(node, name);
+
+  OpenBody();
+
+  auto result = node->type_->as_fun.result_type;
+  auto slot = result_slot_;
+  auto out = Value::None();
+
+  if (ReturnsInSlot(result, false) && slot.tag == Value::NONE) {
+    // A member with a C name returns the aggregate the group builds
+    slot = out = GenTemporary();
+    auto [size, alignment] = SizeAlign(result);
+    PrintAlloc(slot, alignment, size);
+  } else if (!measure_.IsZST(result) && slot.tag == Value::NONE) {
+    out = GenTemporary();
+  }
+
+  if (slot.tag != Value::NONE) {
+    Print("  call ${} (w {}, l {}, ", group, selector, slot);
+  } else if (out.tag == Value::NONE) {
+    Print("  call ${} (w {}, ", group, selector);
+  } else {
+    Print("  {} ={} call ${} (w {}, ", out, ToQbeType(result), group, selector);
+  }
+
+  for (size_t k = 0; k < members.size(); k++) {
+    auto& pack = members[k]->type_->as_fun.param_pack;
+
+    for (size_t i = 0; i < pack.size(); i++) {
+      if (measure_.IsZST(pack[i])) {
+        continue;
+      }
+
+      auto cls = measure_.IsCompound(pack[i]) ? std::string_view{"l"}
+                                              : ToQbeType(pack[i]);
+      Print("{} {}, ", cls, k == selector ? params[i].Emit() : "0");
+    }
+  }
+
+  Print(")\n");
+  Return(out);
+
+  SpliceEntry("");
+  Commit(std::move(name));
+
+  RegisterTest(node);
+}
+
+////////////////////////////////////////////////////////////////////
+
+}  // namespace qbe
@@ -0,0 +1,93 @@
+#include <types/constraints/call_graph.hpp>
+
+#include <ast/patterns.hpp>
+
+#include <algorithm>
+
+namespace types::constraints {
+
+//////////////////////////////////////////////////////////////////////
+
+void CallGraph::AddDefinition(FunDeclStatement* def) {
+  nodes_[def].order = definitions_.size();
+  definitions_.push_back(def);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+std::vector<BindingGroup> CallGraph::BindingGroups() {
+  for (auto def : definitions_) {
+    current_ = &nodes_.at(def);
+    def->Accept(this);
+  }
+
+  for (auto def : definitions_) {
+    if (!nodes_.at(def).visited) {
+      StrongConnect(def);
+    }
+  }
+
+  return std::move(groups_);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void CallGraph::StrongConnect(FunDeclStatement* def) {
+  auto& node = nodes_.at(def);
+
+  node.index = node.lowlink = index_++;
+  node.visited = node.on_stack = true;
+  stack_.push_back(def);
+
+  for (auto callee : node.callees) {
+    auto& next = nodes_.at(callee);
+
+    if (!next.visited) {
+      StrongConnect(callee);
+      node.lowlink = std::min(node.lowlink, next.lowlink);
+    } else if (next.on_stack) {
+      node.lowlink = std::min(node.lowlink, next.index);
+    }
+  }
+
+  if (node.lowlink != node.index) {
+    return;
+  }
+
+  BindingGroup group;
+  FunDeclStatement* member = nullptr;
+
+  do {
+    member = stack_.back();
+    stack_.pop_back();
+    nodes_.at(member).on_stack = false;
+    group.push_back(member);
+  } while (member != def);
+
+  std::sort(group.begin(), group.end(), [this](auto a, auto b) {
+    return nodes_.at(a).order < nodes_.at(b).order;
+  });
+
+  groups_.push_back(std::move(group));
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void CallGraph::VisitVarAccess(VarAccessExpression* node) {
+  auto symbol = node->layer_->RetrieveSymbol(node->GetName(), true);
+
+  if (!symbol || symbol->sym_type != ast::scope::SymbolType::FUN) {
+    return;
+  }
+
+  auto def = symbol->as_fn_sym.def;
+
+  // Definitions from other modules are already generalized
+  if (nodes_.contains(def)) {
+    current_->callees.push_back(def);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace types::constraints
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ast/visitors/just_walk_visitor.hpp>
+#include <ast/declarations.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+namespace types::constraints {
+
+//////////////////////////////////////////////////////////////////////
+
+using BindingGroup = std::vector<FunDeclStatement*>;
+
+//////////////////////////////////////////////////////////////////////
+
+// Who-calls-what graph over the definitions of one module. Its strongly
+// connected components are the binding groups: mutually recursive
+// functions have to be generalized together.
+
+class CallGraph : public JustWalk {
+ public:
+  void AddDefinition(FunDeclStatement* def);
+
+  // Tarjan's algorithm, components come out callees first
+  std::vector<BindingGroup> BindingGroups();
+
+  // Calls, as well as taking a function's address, go through here
+  void VisitVarAccess(VarAccessExpression* node) override;
+
+ private:
+  struct Node {
+    size_t order = 0;  // Position in the source, for stable output
+
+    std::vector<FunDeclStatement*> callees;
+
+    size_t index = 0;
+    size_t lowlink = 0;
+    bool visited = false;
+    bool on_stack = false;
+  };
+
+  void StrongConnect(FunDeclStatement* def);
+
+ private:
+  std::vector<FunDeclStatement*> definitions_;
+  std::unordered_map<FunDeclStatement*, Node> nodes_;
+
+  // Definition whose body is being walked
+  Node* current_ = nullptr;
+
+  // Tarjan's state
+  size_t index_ = 0;
+  std::vector<FunDeclStatement*> stack_;
+  std::vector<BindingGroup> groups_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace types::constraints
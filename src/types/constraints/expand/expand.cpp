@@ -73,6 +73,15 @@ void Traverse(Type* ty) {
     case TypeTag::TY_VARIABLE:
     case TypeTag::TY_PARAMETER:
     case TypeTag::TY_INT:
+    case TypeTag::TY_INT64:
+    case TypeTag::TY_I8:
+    case TypeTag::TY_I16:
+    case TypeTag::TY_U8:
+    case TypeTag::TY_U16:
+    case TypeTag::TY_U32:
+    case TypeTag::TY_U64:
+    case TypeTag::TY_F32:
+    case TypeTag::TY_F64:
     case TypeTag::TY_BOOL:
     case TypeTag::TY_CHAR:
     case TypeTag::TY_UNIT:
@@ -170,6 +179,10 @@ void ExpandTypeVariables::VisitAddressof(AddressofExpression*) {
 void ExpandTypeVariables::VisitIf(IfExpression*) {
 }
 
+void ExpandTypeVariables::VisitWhile(WhileExpression* node) {
+  node->body_->Accept(this);
+}
+
 void ExpandTypeVariables::VisitMatch(MatchExpression*) {
 }
 
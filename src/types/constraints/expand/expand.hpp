@@ -17,6 +17,7 @@ class ExpandTypeVariables : public AbortVisitor {
 
   void VisitYield(YieldStatement* node) override;
   void VisitReturn(ReturnStatement* node) override;
+  void VisitLoopControl(LoopControlStatement*) override{};
   void VisitAssignment(AssignmentStatement* node) override;
   void VisitExprStatement(ExprStatement* node) override;
 
@@ -37,6 +38,7 @@ class ExpandTypeVariables : public AbortVisitor {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitWhile(WhileExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
@@ -5,6 +5,8 @@
 #include <ast/patterns.hpp>
 #include <lex/token.hpp>
 
+#include <limits>
+
 namespace types::constraints::generate {
 
 //////////////////////////////////////////////////////////////////////
@@ -153,6 +155,12 @@ void AlgorithmW::VisitReturn(ReturnStatement* node) {
 
 //////////////////////////////////////////////////////////////////////
 
+void AlgorithmW::VisitLoopControl(LoopControlStatement*) {
+  return_value = &builtin_never;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void AlgorithmW::VisitAssignment(AssignmentStatement* node) {
   auto value_ty = Eval(node->value_);
   auto target_ty = Eval(node->target_);
@@ -201,14 +209,21 @@ void AlgorithmW::VisitComparison(ComparisonExpression* node) {
 //////////////////////////////////////////////////////////////////////
 
 void AlgorithmW::VisitBinary(BinaryExpression* node) {
-  PushEqual(node->GetLocation(), Eval(node->right_), &builtin_int);
+  auto right = Eval(node->right_);
 
   node->type_ = return_value = Eval(node->left_);
 
+  // Products are only taken of two numbers of the same type
+  if (node->operator_.type == lex::TokenType::STAR ||
+      node->operator_.type == lex::TokenType::DIV) {
+    PushEqual(node->GetLocation(), right, return_value);
+    return;
+  }
+
   work_queue_.push_back(Trait{
       .tag = TraitTags::ADD,
       .bound = return_value,
-      .none = {},
+      .add = {.operand = right},
       .location = node->GetLocation(),
   });
 }
@@ -219,8 +234,14 @@ void AlgorithmW::VisitUnary(UnaryExpression* node) {
   auto result = Eval(node->operand_);
 
   switch (node->operator_.type) {
+    // Like `0 - a`, which rules out pointers
     case lex::TokenType::MINUS:
-      PushEqual(node->GetLocation(), Eval(node->operand_), &builtin_int);
+      work_queue_.push_back(Trait{
+          .tag = TraitTags::ADD,
+          .bound = result,
+          .add = {.operand = result},
+          .location = node->GetLocation(),
+      });
       break;
 
     case lex::TokenType::NOT:
@@ -270,6 +291,20 @@ void AlgorithmW::VisitIf(IfExpression* node) {
 
 //////////////////////////////////////////////////////////////////////
 
+void AlgorithmW::VisitWhile(WhileExpression* node) {
+  PushEqual(node->GetLocation(), Eval(node->condition_), &builtin_bool);
+
+  Eval(node->body_);  // unused
+
+  if (node->step_) {
+    Eval(node->step_);
+  }
+
+  return_value = &builtin_unit;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void AlgorithmW::VisitMatch(MatchExpression* node) {
   auto result_ty = MakeTypeVar();
   auto target_ty = Eval(node->against_);
@@ -334,7 +369,6 @@ void AlgorithmW::VisitFnCall(FnCallExpression* node) {
 
   KnownParams map = {};
   ty = Instantinate(ty, map);
-  SetTyContext(ty, ctx);
 
   // Build function type bases on arguments
 
@@ -345,7 +379,7 @@ void AlgorithmW::VisitFnCall(FnCallExpression* node) {
   auto result_ty = MakeTypeVar(ctx);
   auto f = MakeFunType(std::move(result), result_ty);
 
-  SetTyContext(f, ty->typing_context_);
+  SetTyContext(f, ctx);
   node->callable_type_ = f;
 
   // Constrain
@@ -388,6 +422,19 @@ void AlgorithmW::VisitIntrinsic(IntrinsicCall* node) {
       return_value = &builtin_bool;
       break;
 
+    case ast::elaboration::Intrinsic::DELETE:
+      PushEqual(node->GetLocation(), Eval(node->arguments_.at(0)),
+                MakeTypePtr(MakeTypeVar(node->layer_)));
+      return_value = &builtin_unit;
+      break;
+
+    // The size of the pointee, the pointer itself is never read
+    case ast::elaboration::Intrinsic::SIZE_OF:
+      PushEqual(node->GetLocation(), Eval(node->arguments_.at(0)),
+                MakeTypePtr(MakeTypeVar(node->layer_)));
+      return_value = &builtin_int;
+      break;
+
     default:
       std::abort();
   }
@@ -445,7 +492,15 @@ void AlgorithmW::VisitVarAccess(VarAccessExpression* node) {
 void AlgorithmW::VisitLiteral(LiteralExpression* node) {
   switch (node->token_.type) {
     case lex::TokenType::NUMBER:
-      return_value = &builtin_int;
+      // A literal too wide for Int is an Int64
+      return_value = std::get<int64_t>(node->token_.sem_info) >
+                             std::numeric_limits<int32_t>::max()
+                         ? &builtin_int64
+                         : &builtin_int;
+      break;
+
+    case lex::TokenType::FLOAT:
+      return_value = &builtin_f64;
       break;
 
     case lex::TokenType::STRING:
@@ -20,6 +20,7 @@ class AlgorithmW : public ReturnVisitor<Type*> {
 
   void VisitYield(YieldStatement* node) override;
   void VisitReturn(ReturnStatement* node) override;
+  void VisitLoopControl(LoopControlStatement* node) override;
   void VisitAssignment(AssignmentStatement* node) override;
   void VisitExprStatement(ExprStatement* node) override;
 
@@ -40,6 +41,7 @@ class AlgorithmW : public ReturnVisitor<Type*> {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitWhile(WhileExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
@@ -7,27 +7,32 @@ namespace types::constraints {
 ConstraintSolver::ConstraintSolver() {
 }
 
-// Wrapper to give already sorted defs
+// Splits the definitions of a module into binding groups
 void ConstraintSolver::CollectAndSolve(SortedFuns& definitions) {
+  CallGraph graph;
+
   for (auto def : definitions) {
     if (auto fun = def->as<FunDeclStatement>()) {
-      binding_groups_.push_back({fun});
+      graph.AddDefinition(fun);
       continue;
     }
 
     if (auto impl = def->as<ImplDeclaration>()) {
       for (auto method : impl->trait_methods_) {
-        binding_groups_.push_back({method});
+        graph.AddDefinition(method);
       }
       continue;
     }
 
     if (auto trait = def->as<TraitDeclaration>()) {
       for (auto method : trait->methods_) {
-        binding_groups_.push_back({method});
+        graph.AddDefinition(method);
       }
     }
   }
+
+  binding_groups_ = graph.BindingGroups();
+
   CollectAndSolve();
 }
 
@@ -35,12 +40,18 @@ void ConstraintSolver::CollectAndSolve() {
   generate::AlgorithmW generator(work_queue_, *this);
 
   for (auto& group : binding_groups_) {
+    std::move(deferred_.begin(), deferred_.end(),
+              std::back_inserter(work_queue_));
+    deferred_.clear();
+
     for (auto def : group) {
       def->Accept(&generator);
     }
 
     SolveBatch();
 
+    DeferFieldConstraints();
+
     GeneralizeBindingGroup(group);
 
     ConstrainGenerics();
@@ -51,9 +62,36 @@ void ConstraintSolver::CollectAndSolve() {
     }
   }
 
+  if (deferred_.size()) {
+    std::swap(work_queue_, deferred_);
+    PrintQueue();
+    throw std::runtime_error{"Residual constraints remain!"};
+  }
+
   binding_groups_.clear();
 }
 
+// A compound initializer only learns its struct type from the context, which
+// may be a caller in a later binding group. Such variables are lowered to the
+// monomorphic level (like any variable reachable from them) and wait there.
+
+void ConstraintSolver::DeferFieldConstraints() {
+  std::deque<Trait> residual;
+
+  for (auto& q : work_queue_) {
+    if (q.tag == TraitTags::HAS_FIELD &&
+        FindLeader(q.bound)->tag == TypeTag::TY_VARIABLE) {
+      LowerLevels(q.bound, kMonomorphicLevel);
+      LowerLevels(q.has_field.field_type, kMonomorphicLevel);
+      deferred_.push_back(q);
+    } else {
+      residual.push_back(q);
+    }
+  }
+
+  std::swap(work_queue_, residual);
+}
+
 void ConstraintSolver::ConstrainGenerics() {
   while (work_queue_.size()) {
     auto& q = work_queue_.front();
@@ -76,7 +114,7 @@ void ConstraintSolver::GeneralizeBindingGroup(BindingGroup& group) {
   }
 }
 
-bool ConstraintSolver::TrySolveConstraint(Trait i) {
+void ConstraintSolver::TrySolveConstraint(Trait i) {
   fmt::print(stderr, "Solving constraint {}\n", FormatTrait(i));
   CheckTypes();
 
@@ -85,43 +123,56 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
       if (!Unify(i.types_equal.a, i.types_equal.b)) {
         errors_.push_back(i);
       }
-      return true;
+      return;
 
-    case TraitTags::ADD:
+    case TraitTags::ADD: {
       i.bound = FindLeader(i.bound);
 
-      if (i.bound->tag == TypeTag::TY_VARIABLE ||
-          i.bound->tag == TypeTag::TY_PARAMETER) {
+      if (i.bound->tag == TypeTag::TY_VARIABLE) {
+        Park(i);
+        return;
+      }
+
+      if (i.bound->tag == TypeTag::TY_PARAMETER) {
         i.bound->as_parameter.constraints.push_back(i);
+        return;
       }
 
-      return true;
+      // An Int offset goes with any type but a float, an Int64 one also
+      // with pointers. Otherwise both operands have the same type.
+
+      auto operand = FindLeader(i.add.operand);
+      auto is_ptr = i.bound->tag == TypeTag::TY_PTR;
+      auto is_float = i.bound->tag == TypeTag::TY_F32 ||
+                      i.bound->tag == TypeTag::TY_F64;
+
+      if ((operand->tag == TypeTag::TY_INT && !is_float) ||
+          (operand->tag == TypeTag::TY_INT64 && is_ptr)) {
+        return;
+      }
+
+      work_queue_.push_back(MakeTyEqTrait(
+          operand, is_ptr ? &builtin_int : i.bound, i.location));
+      return;
+    }
 
     case TraitTags::EQ:
       i.bound = FindLeader(i.bound);
-      if (i.bound->tag <= TypeTag::TY_PTR) {
-        return true;
-        fill_queue_.push_back(i);
-      }
-      return false;
+      return;
 
     case TraitTags::CALLABLE:
       i.bound = FindLeader(i.bound);
-      if (i.bound->tag == TypeTag::TY_FUN) {
-        return true;
-      } else {
-        fill_queue_.push_back(i);
-        return false;
+      if (i.bound->tag != TypeTag::TY_FUN) {
+        Park(i);
       }
+      return;
 
     case TraitTags::ORD:
       i.bound = FindLeader(i.bound);
-      if (i.bound->tag <= TypeTag::TY_CHAR) {
-        return true;
-      } else {
-        fill_queue_.push_back(i);
-        return false;
+      if (i.bound->tag > TypeTag::TY_CHAR) {
+        Park(i);
       }
+      return;
 
     case TraitTags::CONVERTIBLE_TO:
       i.bound = FindLeader(i.bound);
@@ -130,27 +181,27 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
       if (i.convertible_to.to_type->tag == TypeTag::TY_PTR &&
           i.bound->tag == TypeTag::TY_UNIT) {
         // Convert Unit to pointers (resulting in nullptr)
-        return true;
+        return;
       }
 
       if (i.convertible_to.to_type->tag == TypeTag::TY_BOOL &&
           i.bound->tag == TypeTag::TY_PTR) {
         // Contextual conversion of ptr to bool
-        return true;
+        return;
       }
 
       if (i.convertible_to.to_type->tag == TypeTag::TY_INT &&
           i.bound->tag == TypeTag::TY_CHAR) {
         // Extension
-        return true;
+        return;
       }
 
       if (i.convertible_to.to_type->tag == TypeTag::TY_PTR &&
           i.bound->tag == TypeTag::TY_PTR) {
         // Always convert pointers, no questions asked
-        return true;
+        return;
       }
-      return false;
+      return;
 
     case TraitTags::HAS_FIELD:
       i.bound = FindLeader(i.bound);
@@ -161,14 +212,13 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
         for (auto& p : pack) {
           if (p.field == i.has_field.field_name) {
             auto field_type = i.has_field.field_type;
-            fill_queue_.push_back(MakeTyEqTrait(p.ty, field_type, i.location));
-            return true;
+            work_queue_.push_back(MakeTyEqTrait(p.ty, field_type, i.location));
+            return;
           }
         }
 
         errors_.push_back(i);
-
-        return true;
+        return;
       }
 
       if (i.bound->tag == TypeTag::TY_SUM) {
@@ -177,25 +227,25 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
         for (auto& p : pack) {
           if (p.field == i.has_field.field_name) {
             auto field_type = i.has_field.field_type;
-            fill_queue_.push_back(MakeTyEqTrait(p.ty, field_type, i.location));
-            return true;
+            work_queue_.push_back(MakeTyEqTrait(p.ty, field_type, i.location));
+            return;
           }
         }
 
         errors_.push_back(i);
-        return true;
+        return;
       }
 
       if (i.bound->tag == TypeTag::TY_APP) {
         i.bound = ApplyTyconsLazy(i.bound);
         fmt::print(stderr, "Applied tycons {}\n", FormatType(*i.bound));
-        fill_queue_.push_back(i);
-        return true;
+        work_queue_.push_back(i);
+        return;
       }
 
       if (i.bound->tag != TypeTag::TY_VARIABLE) {
         errors_.push_back(i);
-        return true;
+        return;
       }
 
     case TraitTags::USER_DEFINED:
@@ -203,31 +253,96 @@ bool ConstraintSolver::TrySolveConstraint(Trait i) {
       break;
   }
 
-  fill_queue_.push_back(i);
-  return false;
+  Park(i);
 }
 
 void ConstraintSolver::SolveBatch() {
   PrintQueue();
 
-  bool once_more = true;
-
-  while (std::exchange(once_more, false)) {
+  do {
     while (work_queue_.size()) {
       auto i = std::move(work_queue_.front());
-      once_more |= TrySolveConstraint(std::move(i));
       work_queue_.pop_front();
+      TrySolveConstraint(std::move(i));
     }
+  } while (DefaultOperands());
+
+  // Whatever is still blocked is left for ConstrainGenerics, in order
 
-    std::swap(work_queue_, fill_queue_);
+  for (auto& trait : blocked_) {
+    if (trait) {
+      work_queue_.push_back(*trait);
+    }
   }
 
+  blocked_.clear();
+  watchers_.clear();
+
   if (errors_.size()) {
     ReportErrors();
     throw std::runtime_error{"Final unification error"};
   }
 }
 
+// A blocked constraint can only make progress once its bound is resolved,
+// so it sleeps on that variable until Unify assigns it a leader
+
+// `a + b` with `a` still unknown says nothing about `b`, which is then
+// taken to be an Int, the offset every type accepts. One at a time, as
+// that may tell what other operands are. The rest constrain generics.
+
+bool ConstraintSolver::DefaultOperands() {
+  auto waiting = [](std::optional<Trait>& trait) {
+    return trait && trait->tag == TraitTags::ADD &&
+           FindLeader(trait->bound)->tag == TypeTag::TY_VARIABLE;
+  };
+
+  for (auto& trait : blocked_) {
+    if (waiting(trait) &&
+        FindLeader(trait->add.operand)->tag == TypeTag::TY_VARIABLE) {
+      work_queue_.push_back(
+          MakeTyEqTrait(trait->add.operand, &builtin_int, trait->location));
+      return true;
+    }
+  }
+
+  for (auto& trait : blocked_) {
+    if (waiting(trait)) {
+      FindLeader(trait->bound)->as_parameter.constraints.push_back(*trait);
+      trait.reset();
+    }
+  }
+
+  return false;
+}
+
+void ConstraintSolver::Park(Trait trait) {
+  trait.bound = FindLeader(trait.bound);
+
+  if (trait.bound->tag == TypeTag::TY_VARIABLE) {
+    watchers_[trait.bound].push_back(blocked_.size());
+  }
+
+  blocked_.push_back(std::move(trait));
+}
+
+void ConstraintSolver::Wake(Type* variable) {
+  auto it = watchers_.find(variable);
+
+  if (it == watchers_.end()) {
+    return;
+  }
+
+  for (auto index : it->second) {
+    if (blocked_[index]) {
+      work_queue_.push_back(*blocked_[index]);
+      blocked_[index].reset();
+    }
+  }
+
+  watchers_.erase(it);
+}
+
 void ConstraintSolver::ReportErrors() {
   for (auto& error : errors_) {
     fmt::print("Cannot satisfy bound {} arising from {}\n",  //
@@ -1,16 +1,23 @@
 #pragma once
 
+#include <types/constraints/call_graph.hpp>
 #include <types/constraints/trait.hpp>
 #include <types/type.hpp>
 
 #include <ast/declarations.hpp>
 
+#include <unordered_map>
+#include <optional>
 #include <utility>
 #include <queue>
 
 namespace types::constraints {
 
-using BindingGroup = std::vector<FunDeclStatement*>;
+// Rémy-style levels: variables are created at level 1 (see Type::level),
+// those which have to outlive their binding group are lowered to the
+// monomorphic level and are never generalized
+
+inline constexpr size_t kMonomorphicLevel = 0;
 
 class ConstraintSolver {
  public:
@@ -19,7 +26,7 @@ class ConstraintSolver {
   void CollectAndSolve();
 
   using SortedFuns = std::vector<Declaration*>;
-  void CollectAndSolve(SortedFuns& binding_group);
+  void CollectAndSolve(SortedFuns& definitions);
 
   bool Unify(Type* a, Type* b);
 
@@ -30,19 +37,32 @@ class ConstraintSolver {
   void ReportErrors();
 
   void Generalize(Type* ty);
+  void LowerLevels(Type* ty, size_t level);
   bool UnifyUnderlyingTypes(Type* a, Type* b);
 
   void ConstrainGenerics();
-  bool TrySolveConstraint(Trait i);
+  void DeferFieldConstraints();
+  void TrySolveConstraint(Trait i);
+
+  bool DefaultOperands();
+
+  void Park(Trait trait);
+  void Wake(Type* variable);
   void GeneralizeBindingGroup(BindingGroup& group);
 
  private:
   std::vector<BindingGroup> binding_groups_;
 
   std::deque<Trait> work_queue_;
-  std::deque<Trait> fill_queue_;
+
+  // Constraints waiting for a variable, indexed by the watch list
+  std::vector<std::optional<Trait>> blocked_;
+  std::unordered_map<Type*, std::vector<size_t>> watchers_;
 
   std::deque<Trait> errors_;
+
+  // Field constraints carried over to later binding groups
+  std::deque<Trait> deferred_;
 };
 
 }  // namespace types::constraints
@@ -32,6 +32,11 @@ struct HasFieldTrait {
   Type* field_type = nullptr;
 };
 
+// The right operand of `a + b`, with `a` as the bound
+struct AddTrait {
+  Type* operand = nullptr;
+};
+
 struct ConvertibleToTrait {
   Type* to_type = nullptr;
 };
@@ -56,6 +61,7 @@ struct Trait {
     None none;  // shut up [-Wmissing-field-initializers] warnings
 
     ConvertibleToTrait convertible_to;
+    AddTrait add;
     HasFieldTrait has_field;
     TypesEqual types_equal;
     UserDefinedTrait* user;
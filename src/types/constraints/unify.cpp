@@ -2,6 +2,7 @@
 #include <types/constraints/trait.hpp>
 
 #include <unordered_map>
+#include <algorithm>
 
 namespace types::constraints {
 
@@ -27,7 +28,13 @@ bool ConstraintSolver::Unify(Type* a, Type* b) {
   if (la->tag == TypeTag::TY_VARIABLE) {
     la->leader = lb;
 
+    // Whatever a monomorphic variable is bound to is monomorphic as well
+    if (la->level == kMonomorphicLevel) {
+      LowerLevels(lb, kMonomorphicLevel);
+    }
+
     // Do not merge constraints here, but find leader in solver
+    Wake(la);
 
     return true;
   }
@@ -185,7 +192,10 @@ void ConstraintSolver::Generalize(Type* ty) {
       break;
 
     case TypeTag::TY_VARIABLE:
-      l->tag = TypeTag::TY_PARAMETER;
+      // Only variables of the group being generalized, see LowerLevels
+      if (l->level > kMonomorphicLevel) {
+        l->tag = TypeTag::TY_PARAMETER;
+      }
       break;
 
     case TypeTag::TY_PARAMETER:
@@ -203,4 +213,50 @@ void ConstraintSolver::Generalize(Type* ty) {
 
 //////////////////////////////////////////////////////////////////////
 
+void ConstraintSolver::LowerLevels(Type* ty, size_t level) {
+  auto l = FindLeader(ty);
+
+  switch (l->tag) {
+    case TypeTag::TY_PTR:
+      LowerLevels(l->as_ptr.underlying, level);
+      break;
+
+    case TypeTag::TY_STRUCT:
+      for (auto& mem : l->as_struct.first) {
+        LowerLevels(mem.ty, level);
+      }
+      break;
+
+    case TypeTag::TY_SUM:
+      for (auto& mem : l->as_sum.first) {
+        if (mem.ty) {
+          LowerLevels(mem.ty, level);
+        }
+      }
+      break;
+
+    case TypeTag::TY_FUN:
+      for (auto& p : l->as_fun.param_pack) {
+        LowerLevels(p, level);
+      }
+      LowerLevels(l->as_fun.result_type, level);
+      break;
+
+    case TypeTag::TY_APP:
+      for (auto& mem : l->as_tyapp.param_pack) {
+        LowerLevels(mem, level);
+      }
+      break;
+
+    case TypeTag::TY_VARIABLE:
+      l->level = std::min(l->level, level);
+      break;
+
+    default:
+      break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
 };  // namespace types::constraints
@@ -5,25 +5,257 @@
 
 #include <lex/token.hpp>
 
+#include <algorithm>
+
 namespace types::instantiate {
 
 //////////////////////////////////////////////////////////////////////
 
-FunDeclStatement* TemplateInstantiator::FindTraitMethod(
-    ast::scope::Symbol* symbol, Type* mono) {
-  for (auto& impl : symbol->as_fn_sym.trait->impls_) {
-    for (auto& def : impl->trait_methods_) {
-      if (def->GetName() == symbol->name) {
-        fmt::print(stderr, "Searching method {} for {}\n", symbol->name,
-                   impl->for_type_->Format());
-        current_substitution_.clear();
-        if (BuildSubstitution(def->type_, mono, current_substitution_)) {
-          fmt::print(stderr, "Substitution suffices\n");
-          fmt::print(stderr, "Type: {}\n", def->type_->Format());
-
-          return def;
+// Head constructor of a type, empty for the ones that match anything
+
+std::string_view HeadKey(Type* ty) {
+  ty = FindLeader(ty);
+
+  switch (ty->tag) {
+    case TypeTag::TY_INT:
+      return "Int";
+    case TypeTag::TY_INT64:
+      return "Int64";
+    case TypeTag::TY_I8:
+      return "I8";
+    case TypeTag::TY_I16:
+      return "I16";
+    case TypeTag::TY_U8:
+      return "U8";
+    case TypeTag::TY_U16:
+      return "U16";
+    case TypeTag::TY_U32:
+      return "U32";
+    case TypeTag::TY_U64:
+      return "U64";
+    case TypeTag::TY_F32:
+      return "F32";
+    case TypeTag::TY_F64:
+      return "F64";
+    case TypeTag::TY_BOOL:
+      return "Bool";
+    case TypeTag::TY_CHAR:
+      return "Char";
+    case TypeTag::TY_UNIT:
+      return "Unit";
+    case TypeTag::TY_PTR:
+      return "*";
+    case TypeTag::TY_FUN:
+      return "->";
+    case TypeTag::TY_STRUCT:
+      return "struct";
+    case TypeTag::TY_SUM:
+      return "sum";
+    case TypeTag::TY_APP:
+      return ty->as_tyapp.name.GetName();
+    default:
+      return "";
+  }
+}
+
+// Where `target` sits inside `ty`, as a list of child indices
+
+bool FindPath(Type* ty, Type* target, std::vector<size_t>& path) {
+  ty = FindLeader(ty);
+
+  if (ty == target) {
+    return true;
+  }
+
+  auto try_child = [&](Type* child, size_t index) {
+    path.push_back(index);
+    if (child && FindPath(child, target, path)) {
+      return true;
+    }
+    path.pop_back();
+    return false;
+  };
+
+  switch (ty->tag) {
+    case TypeTag::TY_PTR:
+      return try_child(ty->as_ptr.underlying, 0);
+
+    case TypeTag::TY_FUN: {
+      auto& pack = ty->as_fun.param_pack;
+      for (size_t i = 0; i < pack.size(); i++) {
+        if (try_child(pack[i], i)) {
+          return true;
         }
       }
+      return try_child(ty->as_fun.result_type, pack.size());
+    }
+
+    case TypeTag::TY_APP: {
+      auto& pack = ty->as_tyapp.param_pack;
+      for (size_t i = 0; i < pack.size(); i++) {
+        if (try_child(pack[i], i)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    case TypeTag::TY_STRUCT: {
+      auto& pack = ty->as_struct.first;
+      for (size_t i = 0; i < pack.size(); i++) {
+        if (try_child(pack[i].ty, i)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    default:
+      return false;
+  }
+}
+
+Type* FollowPath(Type* ty, const std::vector<size_t>& path) {
+  for (auto index : path) {
+    ty = FindLeader(ty);
+
+    switch (ty->tag) {
+      case TypeTag::TY_PTR:
+        ty = ty->as_ptr.underlying;
+        break;
+
+      case TypeTag::TY_FUN: {
+        auto& pack = ty->as_fun.param_pack;
+        ty = index < pack.size() ? pack[index] : ty->as_fun.result_type;
+        break;
+      }
+
+      case TypeTag::TY_APP:
+        if (index >= ty->as_tyapp.param_pack.size()) {
+          return nullptr;
+        }
+        ty = ty->as_tyapp.param_pack[index];
+        break;
+
+      case TypeTag::TY_STRUCT:
+        if (index >= ty->as_struct.first.size()) {
+          return nullptr;
+        }
+        ty = ty->as_struct.first[index].ty;
+        break;
+
+      default:
+        return nullptr;
+    }
+  }
+
+  return ty;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Impls of a trait method bucketed by the head constructor of Self, as it
+// appears in the type of the impl's method
+
+auto TemplateInstantiator::IndexTraitMethod(ast::scope::Symbol* symbol)
+    -> MethodIndex& {
+  auto trait = symbol->as_fn_sym.trait;
+
+  // Impls overwrite the def of the symbol, look up the declaration itself
+  auto it = std::find_if(
+      trait->methods_.begin(), trait->methods_.end(),
+      [symbol](auto method) { return method->GetName() == symbol->name; });
+
+  if (it == trait->methods_.end()) {
+    throw std::runtime_error{
+        fmt::format("Trait {} does not declare method {}",
+                    trait->name_.GetName(), symbol->name)};
+  }
+
+  auto decl = *it;
+
+  if (auto found = method_index_.find(decl); found != method_index_.end()) {
+    return found->second;
+  }
+
+  auto& index = method_index_[decl];
+
+  auto self = decl->layer_->RetrieveSymbol("Self", true);
+
+  index.has_self =
+      self && self->sym_type == ast::scope::SymbolType::GENERIC &&
+      FindPath(decl->type_, self->GetType(), index.self_path);
+
+  size_t order = 0;
+
+  for (auto& impl : trait->impls_) {
+    for (auto& def : impl->trait_methods_) {
+      if (def->GetName() != decl->GetName()) {
+        continue;
+      }
+
+      auto self_ty = index.has_self ? FollowPath(def->type_, index.self_path)
+                                    : nullptr;
+      auto head = self_ty ? HeadKey(self_ty) : "";
+
+      if (head.empty()) {
+        index.any_head.push_back({order++, def});
+      } else {
+        index.by_head[head].push_back({order++, def});
+      }
+    }
+  }
+
+  return index;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+FunDeclStatement* TemplateInstantiator::FindTraitMethod(
+    ast::scope::Symbol* symbol, Type* mono) {
+  auto& resolved = resolved_methods_[symbol];
+  auto mangled = Mangle(*mono);
+
+  if (auto it = resolved.find(mangled); it != resolved.end()) {
+    current_substitution_.clear();
+    BuildSubstitution(it->second->type_, mono, current_substitution_);
+    return it->second;
+  }
+
+  auto& index = IndexTraitMethod(symbol);
+
+  // Candidates with the same head, and the ones that fit any head, in the
+  // order the impls were declared in
+
+  std::vector<MethodIndex::Entry> candidates;
+
+  auto self_ty = index.has_self ? FollowPath(mono, index.self_path) : nullptr;
+
+  if (!self_ty) {
+    for (auto& [_, bucket] : index.by_head) {
+      candidates.insert(candidates.end(), bucket.begin(), bucket.end());
+    }
+  } else if (auto it = index.by_head.find(HeadKey(self_ty));
+             it != index.by_head.end()) {
+    candidates = it->second;
+  }
+
+  candidates.insert(candidates.end(), index.any_head.begin(),
+                    index.any_head.end());
+
+  std::sort(candidates.begin(), candidates.end(), [](auto& a, auto& b) {
+    return a.order < b.order;
+  });
+
+  for (auto& [_, def] : candidates) {
+    fmt::print(stderr, "Searching method {} for {}\n", symbol->name,
+               def->type_->Format());
+    current_substitution_.clear();
+    if (BuildSubstitution(def->type_, mono, current_substitution_)) {
+      fmt::print(stderr, "Substitution suffices\n");
+      fmt::print(stderr, "Type: {}\n", def->type_->Format());
+
+      return resolved[mangled] = def;
     }
   }
 
@@ -42,48 +274,49 @@ FunDeclStatement* TemplateInstantiator::GetFunctionDef(
 
 //////////////////////////////////////////////////////////////////////
 
-bool TemplateInstantiator::TryFindInstantiation(FnCallExpression* i) {
-  auto range = mono_items_.equal_range(i->GetFunctionName());
+// Instances are claimed when their call site is discovered, so every
+// item in the queue is a distinct instance and is processed exactly once.
 
-  for (auto it = range.first; it != range.second; ++it) {
-    if (TypesEquivalent(it->second->type_, i->callable_type_)) {
-      return true;
-    }
+void TemplateInstantiator::Enqueue(FnCallExpression* call) {
+  auto symbol = call->layer_->RetrieveSymbol(call->fn_name_);
+
+  if (symbol->sym_type == ast::scope::SymbolType::VAR) {
+    return;
+  }
+
+  if (instances_.Claim(symbol, call->callable_type_)) {
+    instantiation_quque_.push_back(call);
   }
-  return false;
 }
 
 //////////////////////////////////////////////////////////////////////
 
 void TemplateInstantiator::StartUp(FunDeclStatement* main) {
   call_context_ = main->layer_;
+  auto symbol = main->layer_->RetrieveSymbol(main->GetName());
+
+  // Before the body, which may call main again
+  instances_.Claim(symbol, main->type_);
+
   auto main_fn = Eval(main)->as<FunDeclStatement>();
-  mono_items_.insert({main_fn->name_, main_fn});
+  instances_.Record(symbol, main_fn->type_, main_fn);
 }
 
 //////////////////////////////////////////////////////////////////////
 
 void TemplateInstantiator::ProcessQueueItem(FnCallExpression* i) {
-  // 1) Check not already instantiated
-
-  if (TryFindInstantiation(i)) {
-    return;
-  }
+  // 1) Already claimed in Enqueue
 
   auto symbol = i->layer_->RetrieveSymbol(i->fn_name_);
 
-  if (symbol->sym_type == ast::scope::SymbolType::VAR) {
-    return;
-  }
-
-  // 2) Enter context
-
   auto poly = symbol->GetType();
   auto mono = i->callable_type_;
 
   fmt::print(stderr, "[!] Poly {}\n", FormatType(*poly));
   fmt::print(stderr, "[!] Mono {}\n", FormatType(*mono));
 
+  // 2) Enter context
+
   call_context_ = i->layer_;
 
   // 3) Find definition
@@ -101,9 +334,8 @@ void TemplateInstantiator::ProcessQueueItem(FnCallExpression* i) {
   auto mono_fun = Eval(definition)->as<FunDeclStatement>();
 
   // 5) Save result
-  if (mono_fun->body_) {
-    mono_items_.insert({mono_fun->name_, mono_fun});
-  }
+
+  instances_.Record(symbol, mono, mono_fun);
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -147,11 +379,13 @@ using Result = std::pair<std::vector<FunDeclStatement*>, std::vector<Type*>>;
 auto TemplateInstantiator::Flush() -> Result {
   std::vector<FunDeclStatement*> result;
 
-  for (auto& mono : mono_items_) {
+  // Order of first discovery, so the output is the same on every run
+
+  for (auto mono : instances_.InOrder()) {
     fmt::print(stderr, "name: {} type: {}\n",  //
-               mono.second->GetName(), FormatType(*mono.second->type_));
+               mono->GetName(), FormatType(*mono->type_));
 
-    result.push_back(mono.second);
+    result.push_back(mono);
   }
 
   return {std::move(result), std::move(types_to_gen_)};
@@ -262,7 +496,9 @@ void TemplateInstantiator::MaybeSaveForIL(Type* ty) {
     return;
   }
 
-  types_to_gen_.push_back(ty);
+  if (types_seen_.insert(Mangle(*ty)).second) {
+    types_to_gen_.push_back(ty);
+  }
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -109,6 +109,12 @@ void TemplateInstantiator::VisitReturn(ReturnStatement* node) {
 
 //////////////////////////////////////////////////////////////////////
 
+void TemplateInstantiator::VisitLoopControl(LoopControlStatement* node) {
+  return_value = new LoopControlStatement{*node};
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void TemplateInstantiator::VisitAssignment(AssignmentStatement* node) {
   auto n = new AssignmentStatement{*node};
 
@@ -200,6 +206,21 @@ void TemplateInstantiator::VisitIf(IfExpression* node) {
 
 //////////////////////////////////////////////////////////////////////
 
+void TemplateInstantiator::VisitWhile(WhileExpression* node) {
+  auto n = new WhileExpression{*node};
+
+  n->condition_ = Eval(n->condition_)->as<Expression>();
+  n->body_ = Eval(n->body_)->as<Expression>();
+
+  if (n->step_) {
+    n->step_ = Eval(n->step_)->as<Statement>();
+  }
+
+  return_value = n;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 void TemplateInstantiator::VisitMatch(MatchExpression* node) {
   auto n = new MatchExpression{*node};
 
@@ -267,7 +288,7 @@ void TemplateInstantiator::VisitFnCall(FnCallExpression* node) {
   fmt::print(stderr, "{}\n", FormatType(*n->callable_type_));
   fmt::print(stderr, "Adding a node to the queue\n");
 
-  instantiation_quque_.push_back(n);
+  Enqueue(n);
 
   return_value = n;
 }
@@ -335,6 +356,7 @@ void TemplateInstantiator::VisitLiteral(LiteralExpression* node) {
 void TemplateInstantiator::VisitTypecast(TypecastExpression* node) {
   auto n = new TypecastExpression{*node};
 
+  n->expr_ = Eval(node->expr_)->as<Expression>();
   n->type_ = Instantinate(node->type_, current_substitution_);
 
   return_value = n;
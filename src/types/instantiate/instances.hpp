@@ -0,0 +1,71 @@
+#pragma once
+
+#include <types/type.hpp>
+
+#include <ast/scope/context.hpp>
+#include <ast/declarations.hpp>
+
+#include <unordered_map>
+#include <string_view>
+#include <vector>
+
+namespace types::instantiate {
+
+//////////////////////////////////////////////////////////////////////
+
+// The instances found so far. An instance is identified by its symbol
+// and the mangled monomorphic type, and is claimed as soon as a call to
+// it is discovered, so that it is evaluated exactly once.
+//
+// This is the dedup map a parallel instantiation engine would share
+// between its workers. It is not synchronized: instantiation runs on
+// one thread, as the type store, the leaders and the mangling caches it
+// goes through are not safe for concurrent use either.
+
+class InstanceTable {
+ public:
+  // False if the instance was claimed before
+  bool Claim(ast::scope::Symbol* symbol, Type* mono) {
+    return items_.try_emplace({symbol, Mangle(*mono)}, nullptr).second;
+  }
+
+  // Declarations without a body are kept too, but only definitions are
+  // emitted
+  void Record(ast::scope::Symbol* symbol, Type* mono,
+              FunDeclStatement* instance) {
+    items_[{symbol, Mangle(*mono)}] = instance;
+
+    if (instance->body_) {
+      order_.push_back(instance);
+    }
+  }
+
+  // Instances with a body, in order of discovery
+  const std::vector<FunDeclStatement*>& InOrder() const {
+    return order_;
+  }
+
+ private:
+  struct Key {
+    ast::scope::Symbol* symbol;
+    std::string_view mangled;
+
+    bool operator==(const Key&) const = default;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      // Interned, so the address identifies the name
+      auto a = std::hash<void*>{}(key.symbol);
+      auto b = std::hash<const void*>{}(key.mangled.data());
+      return a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2));
+    }
+  };
+
+  std::unordered_map<Key, FunDeclStatement*, KeyHash> items_;
+  std::vector<FunDeclStatement*> order_;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}  // namespace types::instantiate
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <types/instantiate/instances.hpp>
 #include <types/constraints/trait.hpp>
 #include <types/type.hpp>
 
@@ -7,6 +8,7 @@
 #include <ast/scope/context.hpp>
 #include <ast/declarations.hpp>
 
+#include <unordered_set>
 #include <queue>
 
 namespace types::instantiate {
@@ -23,6 +25,7 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
 
   void VisitYield(YieldStatement* node) override;
   void VisitReturn(ReturnStatement* node) override;
+  void VisitLoopControl(LoopControlStatement* node) override;
   void VisitAssignment(AssignmentStatement* node) override;
   void VisitExprStatement(ExprStatement* node) override;
 
@@ -43,6 +46,7 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
   void VisitDeref(DereferenceExpression* node) override;
   void VisitAddressof(AddressofExpression* node) override;
   void VisitIf(IfExpression* node) override;
+  void VisitWhile(WhileExpression* node) override;
   void VisitMatch(MatchExpression* node) override;
   void VisitNew(NewExpression* node) override;
   void VisitBlock(BlockExpression* node) override;
@@ -61,9 +65,25 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
 
   FunDeclStatement* FindTraitMethod(ast::scope::Symbol* symbol, Type* mono);
 
+  struct MethodIndex {
+    struct Entry {
+      size_t order;
+      FunDeclStatement* def;
+    };
+
+    // Position of Self in the method's type
+    bool has_self = false;
+    std::vector<size_t> self_path;
+
+    std::unordered_map<std::string_view, std::vector<Entry>> by_head;
+    std::vector<Entry> any_head;
+  };
+
+  MethodIndex& IndexTraitMethod(ast::scope::Symbol* symbol);
+
   FunDeclStatement* GetFunctionDef(ast::scope::Symbol* symbol, Type* mono);
 
-  bool TryFindInstantiation(FnCallExpression* i);
+  void Enqueue(FnCallExpression* call);
 
   void ProcessQueueItem(FnCallExpression* i);
 
@@ -81,12 +101,20 @@ class TemplateInstantiator : public ReturnVisitor<TreeNode*> {
 
   Substitiution current_substitution_;
 
+  // In order of discovery, each type once
   std::vector<Type*> types_to_gen_;
+  std::unordered_set<std::string_view> types_seen_;
 
   // How do I prevent myself from instantiating something twice or more?
-  // A: place instantiated in map: name: string_view -> [](type, fun)
+  // A: claim (symbol, mangled type) when the call is found, map it to
+  // the instance once it is evaluated
+  InstanceTable instances_;
+
+  // Trait method -> its impls, and the calls already resolved
+  std::unordered_map<FunDeclStatement*, MethodIndex> method_index_;
 
-  std::unordered_multimap<std::string_view, FunDeclStatement*> mono_items_;
+  using Resolved = std::unordered_map<std::string_view, FunDeclStatement*>;
+  std::unordered_map<ast::scope::Symbol*, Resolved> resolved_methods_;
 };
 
 }  // namespace types::instantiate
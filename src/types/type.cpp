@@ -117,6 +117,15 @@ bool TypesEquivalent(Type* lhs, Type* rhs,
       return true;
 
     case TypeTag::TY_INT:
+    case TypeTag::TY_INT64:
+    case TypeTag::TY_I8:
+    case TypeTag::TY_I16:
+    case TypeTag::TY_U8:
+    case TypeTag::TY_U16:
+    case TypeTag::TY_U32:
+    case TypeTag::TY_U64:
+    case TypeTag::TY_F32:
+    case TypeTag::TY_F64:
     case TypeTag::TY_BOOL:
     case TypeTag::TY_CHAR:
     case TypeTag::TY_UNIT:
@@ -403,6 +412,15 @@ Type* SubstituteParameters(Type* subs, const Map& map) {
       std::abort();
 
     case TypeTag::TY_INT:
+    case TypeTag::TY_INT64:
+    case TypeTag::TY_I8:
+    case TypeTag::TY_I16:
+    case TypeTag::TY_U8:
+    case TypeTag::TY_U16:
+    case TypeTag::TY_U32:
+    case TypeTag::TY_U64:
+    case TypeTag::TY_F32:
+    case TypeTag::TY_F64:
     case TypeTag::TY_BOOL:
     case TypeTag::TY_CHAR:
     case TypeTag::TY_UNIT:
@@ -417,13 +435,159 @@ Type* SubstituteParameters(Type* subs, const Map& map) {
 
 //////////////////////////////////////////////////////////////////////
 
+// Names may be shadowed, so an application is identified by the type
+// constructor its name resolves to
+
+static Type* ResolveTycons(Type* app) {
+  auto symbol = app->typing_context_->RetrieveSymbol(app->as_tyapp.name);
+  return symbol->GetType();
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// Writes a structural key of `ty` into `out`, looking through leaders.
+// Returns false if an unresolved variable is reachable: such a type may
+// still change under unification, so it must not be used as a cache key.
+// Applications without a scope to resolve their name in are not keyed.
+
+bool CanonicalKey(Type* ty, std::string& out) {
+  auto l = FindLeader(ty);
+
+  switch (l->tag) {
+    case TypeTag::TY_INT:
+      out += 'i';
+      return true;
+
+    case TypeTag::TY_INT64:
+      out += 'l';
+      return true;
+
+    case TypeTag::TY_I8:
+      out += 'a';
+      return true;
+
+    case TypeTag::TY_I16:
+      out += 's';
+      return true;
+
+    case TypeTag::TY_U8:
+      out += 'h';
+      return true;
+
+    case TypeTag::TY_U16:
+      out += 't';
+      return true;
+
+    case TypeTag::TY_U32:
+      out += 'j';
+      return true;
+
+    case TypeTag::TY_U64:
+      out += 'm';
+      return true;
+
+    case TypeTag::TY_F32:
+      out += 'f';
+      return true;
+
+    case TypeTag::TY_F64:
+      out += 'd';
+      return true;
+
+    case TypeTag::TY_BOOL:
+      out += 'b';
+      return true;
+
+    case TypeTag::TY_CHAR:
+      out += 'c';
+      return true;
+
+    case TypeTag::TY_UNIT:
+      out += 'u';
+      return true;
+
+    case TypeTag::TY_NEVER:
+      out += 'n';
+      return true;
+
+    case TypeTag::TY_PTR:
+      out += 'P';
+      return CanonicalKey(l->as_ptr.underlying, out);
+
+    case TypeTag::TY_STRUCT:
+    case TypeTag::TY_SUM: {
+      auto& pack = l->tag == TypeTag::TY_STRUCT ? l->as_struct.first
+                                                : l->as_sum.first;
+      out += l->tag == TypeTag::TY_STRUCT ? "s{" : "S{";
+      for (auto& p : pack) {
+        out += p.field;
+        out += ':';
+        if (p.ty && !CanonicalKey(p.ty, out)) {
+          return false;
+        }
+        out += ',';
+      }
+      out += '}';
+      return true;
+    }
+
+    case TypeTag::TY_FUN: {
+      out += "f(";
+      for (auto& p : l->as_fun.param_pack) {
+        if (!CanonicalKey(p, out)) {
+          return false;
+        }
+        out += ',';
+      }
+      out += ')';
+      return CanonicalKey(l->as_fun.result_type, out);
+    }
+
+    case TypeTag::TY_APP: {
+      if (!l->typing_context_) {
+        return false;
+      }
+
+      out += fmt::format("{}(", (void*)ResolveTycons(l));
+      for (auto& p : l->as_tyapp.param_pack) {
+        if (!CanonicalKey(p, out)) {
+          return false;
+        }
+        out += ',';
+      }
+      out += ')';
+      return true;
+    }
+
+    case TypeTag::TY_PARAMETER:
+      out += fmt::format("p{};", l->id);
+      return true;
+
+    case TypeTag::TY_VARIABLE:
+      return false;
+
+    case TypeTag::TY_BUILTIN:
+    case TypeTag::TY_KIND:
+    case TypeTag::TY_CONS:
+    case TypeTag::TY_UNION:
+    default:
+      out += fmt::format("#{};", (void*)l);
+      return true;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+// (type constructor, canonical arguments) -> expanded body
+static std::unordered_map<std::string, Type*> tycons_cache{};
+
 Type* ApplyTyconsLazy(Type* ty) {
   if (ty->tag != TypeTag::TY_APP) {
     return nullptr;
   }
 
-  auto symbol = ty->typing_context_->RetrieveSymbol(ty->as_tyapp.name);
-  auto& names = symbol->GetType()->as_tycons.param_pack;
+  auto tycons = ResolveTycons(ty);
+  auto& names = tycons->as_tycons.param_pack;
 
   auto& pack = ty->as_tyapp.param_pack;
 
@@ -431,12 +595,32 @@ Type* ApplyTyconsLazy(Type* ty) {
     throw std::runtime_error("Instantination size mismatch");
   }
 
+  auto key = fmt::format("{}(", (void*)tycons);
+  bool cacheable = true;
+
+  for (auto& p : pack) {
+    if (!(cacheable = CanonicalKey(p, key))) {
+      break;
+    }
+    key += ',';
+  }
+
+  if (cacheable) {
+    if (auto it = tycons_cache.find(key); it != tycons_cache.end()) {
+      return it->second;
+    }
+  }
+
   std::unordered_map<std::string_view, Type*> map;
   for (size_t i = 0; i < pack.size(); i++) {
     map.insert({names[i], pack[i]});
   }
 
-  auto subs = SubstituteParameters(symbol->GetType()->as_tycons.body, map);
+  auto subs = SubstituteParameters(tycons->as_tycons.body, map);
+
+  if (cacheable) {
+    tycons_cache.emplace(std::move(key), subs);
+  }
 
   return subs;
 }
@@ -453,7 +637,8 @@ Type* TypeStorage(Type* t) {
 
 //////////////////////////////////////////////////////////////////////
 
-// Ty here is a type schema
+// Ty here is a type schema. Parts of it that mention no parameters and
+// are already resolved are monomorphic, so the instance shares them.
 Type* Instantinate(Type* ty, KnownParams& map) {
   auto l = FindLeader(ty);
 
@@ -463,6 +648,11 @@ Type* Instantinate(Type* ty, KnownParams& map) {
 
     case TypeTag::TY_PTR: {
       auto i = Instantinate(l->as_ptr.underlying, map);
+
+      if (i == l->as_ptr.underlying) {
+        return l;
+      }
+
       auto ptr = MakeTypePtr(i);
       ptr->typing_context_ = l->typing_context_;
       return ptr;
@@ -476,11 +666,17 @@ Type* Instantinate(Type* ty, KnownParams& map) {
 
     case TypeTag::TY_APP: {
       std::vector<Type*> args;
+      bool shared = true;
 
       auto& pack = l->as_tyapp.param_pack;
 
       for (size_t i = 0; i < pack.size(); i++) {
         args.push_back(Instantinate(pack[i], map));
+        shared &= args.back() == pack[i];
+      }
+
+      if (shared) {
+        return l;
       }
 
       auto app = MakeTyApp(l->as_tyapp.name, std::move(args));
@@ -491,48 +687,50 @@ Type* Instantinate(Type* ty, KnownParams& map) {
 
     case TypeTag::TY_FUN: {
       std::vector<Type*> args;
+      bool shared = true;
 
       auto& pack = l->as_fun.param_pack;
 
       for (size_t i = 0; i < pack.size(); i++) {
         args.push_back(Instantinate(pack[i], map));
+        shared &= args.back() == pack[i];
       }
 
-      auto fun = MakeFunType(std::move(args),
-                             Instantinate(l->as_fun.result_type, map));
+      auto result = Instantinate(l->as_fun.result_type, map);
+      shared &= result == l->as_fun.result_type;
+
+      if (shared) {
+        return l;
+      }
+
+      auto fun = MakeFunType(std::move(args), result);
       fun->typing_context_ = l->typing_context_;
 
       return fun;
     }
 
-    case TypeTag::TY_STRUCT: {
+    case TypeTag::TY_STRUCT:
+    case TypeTag::TY_SUM: {
+      auto& pack = l->tag == TypeTag::TY_STRUCT ? l->as_struct.first
+                                                : l->as_sum.first;
+
       std::vector<Member> args;
-      auto& pack = l->as_struct.first;
+      bool shared = true;
 
       for (auto& p : pack) {
         args.push_back(Member{
             .field = p.field,
-            .ty = Instantinate(p.ty, map),
+            .ty = p.ty ? Instantinate(p.ty, map) : nullptr,
         });
+        shared &= args.back().ty == p.ty;
       }
 
-      auto ty = MakeStructType(std::move(args));
-      ty->typing_context_ = l->typing_context_;
-      return ty;
-    }
-
-    case TypeTag::TY_SUM: {
-      std::vector<Member> args;
-      auto& pack = l->as_sum.first;
-
-      for (auto& p : pack) {
-        args.push_back(Member{
-            .field = p.field,
-            .ty = Instantinate(p.ty, map),
-        });
+      if (shared) {
+        return l;
       }
 
-      auto ty = MakeSumType(std::move(args));
+      auto ty = l->tag == TypeTag::TY_STRUCT ? MakeStructType(std::move(args))
+                                             : MakeSumType(std::move(args));
       ty->typing_context_ = l->typing_context_;
       return ty;
     }
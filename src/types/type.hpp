@@ -21,6 +21,15 @@ struct Type;
 
 enum class TypeTag {
   TY_INT,
+  TY_INT64,
+  TY_I8,
+  TY_I16,
+  TY_U8,
+  TY_U16,
+  TY_U32,
+  TY_U64,
+  TY_F32,
+  TY_F64,
   TY_BOOL,
   TY_CHAR,
   TY_UNIT,
@@ -94,6 +103,15 @@ struct QualifiedGeneric {
 //////////////////////////////////////////////////////////////////////
 
 extern Type builtin_int;
+extern Type builtin_int64;
+extern Type builtin_i8;
+extern Type builtin_i16;
+extern Type builtin_u8;
+extern Type builtin_u16;
+extern Type builtin_u32;
+extern Type builtin_u64;
+extern Type builtin_f32;
+extern Type builtin_f64;
 extern Type builtin_bool;
 extern Type builtin_char;
 extern Type builtin_unit;
@@ -104,7 +122,7 @@ extern Type builtin_kind;
 //////////////////////////////////////////////////////////////////////
 
 std::string FormatType(Type& type);
-std::string Mangle(Type& type);
+std::string_view Mangle(Type& type);
 
 //////////////////////////////////////////////////////////////////////
 
@@ -117,6 +135,8 @@ struct Type {
 
   TypeTag tag = TypeTag::TY_VARIABLE;  // Unknown type
 
+  size_t level = 1;  // Binding level of a variable, see ConstraintSolver
+
   ast::scope::Context* typing_context_ = nullptr;
 
   PtrType as_ptr{};
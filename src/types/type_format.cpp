@@ -1,5 +1,8 @@
 #include <types/type.hpp>
 
+#include <unordered_set>
+#include <utility>
+
 namespace types {
 
 //////////////////////////////////////////////////////////////////////
@@ -100,6 +103,24 @@ std::string FormatTypeInner(Type& type) {
       return fmt::format("*");
     case TypeTag::TY_INT:
       return fmt::format("Int");
+    case TypeTag::TY_INT64:
+      return fmt::format("Int64");
+    case TypeTag::TY_I8:
+      return fmt::format("I8");
+    case TypeTag::TY_I16:
+      return fmt::format("I16");
+    case TypeTag::TY_U8:
+      return fmt::format("U8");
+    case TypeTag::TY_U16:
+      return fmt::format("U16");
+    case TypeTag::TY_U32:
+      return fmt::format("U32");
+    case TypeTag::TY_U64:
+      return fmt::format("U64");
+    case TypeTag::TY_F32:
+      return fmt::format("F32");
+    case TypeTag::TY_F64:
+      return fmt::format("F64");
     case TypeTag::TY_BOOL:
       return fmt::format("Bool");
     case TypeTag::TY_CHAR:
@@ -137,67 +158,216 @@ std::string FormatTypeInner(Type& type) {
 
 //////////////////////////////////////////////////////////////////////
 
-std::string MangleFun(Type& type) {
-  std::string result;
-  auto ins = std::back_inserter(result);
-  fmt::format_to(ins, "f{}", type.as_fun.param_pack.size());
-  for (auto& t : type.as_fun.param_pack) {
-    fmt::format_to(ins, "{}", Mangle(*t));
+// Mangling grammar (every production is self-delimiting):
+//
+//   i | b | c | u            Int, Bool, Char, Unit
+//   l                        Int64
+//   a | s | h | t | j | m    I8, I16, U8, U16, U32, U64
+//   f | d                    F32, F64
+//   P <type>                 pointer
+//   F <params> _ <result>    function
+//   <len> <name> [I ... E]   type application, e.g. 3VecIcE
+//   S <fields> E             anonymous struct, each field written as
+//                            <len> <name> <type>, e.g. S1xi1yiE
+//   R <k> _                  k-th compound type already seen in this name
+//
+// Back references keep deeply nested generics short: in
+// `Pair(Vec(Vec(Char)), Vec(Vec(Char)))` the second argument is `R1_`.
+
+class Mangler {
+ public:
+  std::string Mangle(Type* type) {
+    Visit(type);
+    return std::move(output_);
   }
 
-  return result;
-}
+ private:
+  static bool IsCompound(Type* type) {
+    switch (type->tag) {
+      case TypeTag::TY_PTR:
+      case TypeTag::TY_FUN:
+      case TypeTag::TY_STRUCT:
+        return true;
 
-std::string MangleApp(Type& type) {
-  std::string result;
-  auto ins = std::back_inserter(result);
-  fmt::format_to(ins, "{}", type.as_tyapp.name.GetName());
-  for (auto& t : type.as_tyapp.param_pack) {
-    fmt::format_to(ins, "{}", Mangle(*t));
+      case TypeTag::TY_APP:
+        return !type->as_tyapp.param_pack.empty();
+
+      default:
+        return false;
+    }
   }
-  return result;
-}
 
-std::string MangleStruct(Type& type) {
-  std::string result;
-  auto ins = std::back_inserter(result);
-  fmt::format_to(ins, "struct");
-  for (auto& t : type.as_struct.first) {
-    fmt::format_to(ins, "{}", Mangle(*t.ty));
+  void Visit(Type* type) {
+    type = FindLeader(type);
+
+    if (!IsCompound(type)) {
+      VisitInner(type);
+      return;
+    }
+
+    auto id = Identify(type);
+
+    if (auto it = seen_.find(id); it != seen_.end()) {
+      fmt::format_to(std::back_inserter(output_), "R{}_", it->second);
+      return;
+    }
+
+    VisitInner(type);
+    seen_.emplace(id, seen_.size());
   }
-  return result;
-}
 
-std::string Mangle(Type& type) {
-  switch (type.tag) {
-    case TypeTag::TY_INT:
-      return fmt::format("i");
-    case TypeTag::TY_BOOL:
-      return fmt::format("b");
-    case TypeTag::TY_CHAR:
-      return fmt::format("c");
-    case TypeTag::TY_UNIT:
-      return fmt::format("u");
+  // Numbers compound types so that equal ones share a number. The key of
+  // a node is its own production with the children replaced by their
+  // numbers, so every node is keyed once per name.
+  size_t Identify(Type* type) {
+    if (auto it = ids_.find(type); it != ids_.end()) {
+      return it->second;
+    }
 
-    case TypeTag::TY_PTR:
-      return "P" + Mangle(*type.as_ptr.underlying);
-    case TypeTag::TY_FUN:
-      return MangleFun(type);
-    case TypeTag::TY_APP:
-      return MangleApp(type);
+    auto saved = std::exchange(output_, {});
+    auto keying = std::exchange(keying_, true);
 
-    case TypeTag::TY_STRUCT:
-      return MangleStruct(type);
+    VisitInner(type);
 
-    case TypeTag::TY_SUM:
-    case TypeTag::TY_UNION:
-    case TypeTag::TY_VARIABLE:
-    case TypeTag::TY_CONS:
-    case TypeTag::TY_PARAMETER:
-    case TypeTag::TY_KIND:
-    default:
-      std::abort();
+    auto key = std::exchange(output_, std::move(saved));
+    keying_ = keying;
+
+    auto [it, _] = keys_.emplace(std::move(key), keys_.size());
+    return ids_[type] = it->second;
+  }
+
+  void Child(Type* type) {
+    type = FindLeader(type);
+
+    if (!keying_) {
+      Visit(type);
+    } else if (IsCompound(type)) {
+      fmt::format_to(std::back_inserter(output_), "#{};", Identify(type));
+    } else {
+      VisitInner(type);
+    }
   }
+
+  void VisitInner(Type* type) {
+    auto ins = std::back_inserter(output_);
+
+    switch (type->tag) {
+      case TypeTag::TY_INT:
+        output_ += 'i';
+        break;
+      case TypeTag::TY_INT64:
+        output_ += 'l';
+        break;
+      case TypeTag::TY_I8:
+        output_ += 'a';
+        break;
+      case TypeTag::TY_I16:
+        output_ += 's';
+        break;
+      case TypeTag::TY_U8:
+        output_ += 'h';
+        break;
+      case TypeTag::TY_U16:
+        output_ += 't';
+        break;
+      case TypeTag::TY_U32:
+        output_ += 'j';
+        break;
+      case TypeTag::TY_U64:
+        output_ += 'm';
+        break;
+      case TypeTag::TY_F32:
+        output_ += 'f';
+        break;
+      case TypeTag::TY_F64:
+        output_ += 'd';
+        break;
+      case TypeTag::TY_BOOL:
+        output_ += 'b';
+        break;
+      case TypeTag::TY_CHAR:
+        output_ += 'c';
+        break;
+      case TypeTag::TY_UNIT:
+        output_ += 'u';
+        break;
+
+      case TypeTag::TY_PTR:
+        output_ += 'P';
+        Child(type->as_ptr.underlying);
+        break;
+
+      case TypeTag::TY_FUN:
+        output_ += 'F';
+        for (auto& t : type->as_fun.param_pack) {
+          Child(t);
+        }
+        output_ += '_';
+        Child(type->as_fun.result_type);
+        break;
+
+      case TypeTag::TY_APP: {
+        auto name = type->as_tyapp.name.GetName();
+        fmt::format_to(ins, "{}{}", name.size(), name);
+
+        if (type->as_tyapp.param_pack.empty()) {
+          break;
+        }
+
+        output_ += 'I';
+        for (auto& t : type->as_tyapp.param_pack) {
+          Child(t);
+        }
+        output_ += 'E';
+        break;
+      }
+
+      case TypeTag::TY_STRUCT:
+        output_ += 'S';
+        for (auto& t : type->as_struct.first) {
+          output_ += fmt::format("{}{}", t.field.size(), t.field);
+          Child(t.ty);
+        }
+        output_ += 'E';
+        break;
+
+      case TypeTag::TY_SUM:
+      case TypeTag::TY_UNION:
+      case TypeTag::TY_VARIABLE:
+      case TypeTag::TY_CONS:
+      case TypeTag::TY_PARAMETER:
+      case TypeTag::TY_KIND:
+      default:
+        std::abort();
+    }
+  }
+
+ private:
+  std::string output_;
+  std::unordered_map<size_t, size_t> seen_;
+
+  std::unordered_map<Type*, size_t> ids_;
+  std::unordered_map<std::string, size_t> keys_;
+  bool keying_ = false;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Mangled names are interned: every distinct name is stored once and
+// handed out as a view, which stays valid for the whole compilation.
+
+static std::unordered_set<std::string> mangle_pool{};
+static std::unordered_map<Type*, std::string_view> mangle_cache{};
+
+std::string_view Mangle(Type& type) {
+  auto leader = FindLeader(&type);
+
+  if (auto it = mangle_cache.find(leader); it != mangle_cache.end()) {
+    return it->second;
+  }
+
+  auto [it, _] = mangle_pool.insert(Mangler{}.Mangle(leader));
+  return mangle_cache[leader] = *it;
 }
 
 //////////////////////////////////////////////////////////////////////